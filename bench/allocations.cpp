@@ -0,0 +1,69 @@
+// Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+//
+// This file is part of dromozoa-compiler.
+//
+// dromozoa-compiler is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dromozoa-compiler is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+//
+// You should have received a copy of the GNU General Public License
+// and a copy of the GCC Runtime Library Exception along with
+// dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+// linked into the benchmark programs to count the allocations. the count is
+// written to the standard error at the exit.
+
+#include "allocations.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+  unsigned long long allocations = 0;
+
+  struct report_t {
+    ~report_t() {
+      std::fprintf(stderr, "allocations\t%llu\n", allocations);
+    }
+  };
+
+  report_t report;
+}
+
+namespace dromozoa {
+  namespace bench {
+    unsigned long long allocations() {
+      return ::allocations;
+    }
+  }
+}
+
+// not inlined, so that gcc does not pair malloc with delete.
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
@@ -0,0 +1,58 @@
+// Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+//
+// This file is part of dromozoa-compiler.
+//
+// dromozoa-compiler is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dromozoa-compiler is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+//
+// You should have received a copy of the GNU General Public License
+// and a copy of the GCC Runtime Library Exception along with
+// dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DROMOZOA_COMPILER_BENCH_ALLOCATIONS_HPP
+#define DROMOZOA_COMPILER_BENCH_ALLOCATIONS_HPP
+
+// the allocation counter of allocations.cpp and the timing harness of the
+// microbenchmarks in test. build them with -Ibench and link allocations.cpp.
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+namespace dromozoa {
+  namespace bench {
+    // the number of the allocations so far.
+    unsigned long long allocations();
+
+    // runs the function n times and writes the time and the allocations per
+    // run. the results are summed, so that the runs are not optimized out.
+    template <class T>
+    void bench(const char* name, std::size_t n, T function) {
+      double sum = 0;
+      const auto count = allocations();
+      const auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < n; ++i) {
+        sum += function(i);
+      }
+      const auto stop = std::chrono::steady_clock::now();
+      std::cout
+          << name
+          << "\t" << std::chrono::duration<double, std::nano>(stop - start).count() / n << " ns/op"
+          << "\t" << static_cast<double>(allocations() - count) / n << " allocations/op"
+          << "\t(" << sum << ")\n";
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,104 @@
+#! /bin/sh -e
+
+# Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+#
+# This file is part of dromozoa-compiler.
+#
+# dromozoa-compiler is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# dromozoa-compiler is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+# usage: bench/bench.sh [program...]
+#
+# compiles each program in bench/programs in every mode and runs it with PUC
+# Lua, the ES backend and the C++ backend at -O2. the results are written to
+# the standard output as JSON lines; the wall time is in seconds and the peak
+# resident set size in kilobytes. the allocations are counted for the C++
+# backend only. ok is true if the output is same as PUC Lua.
+
+LUA_PATH="?.lua;;"
+export LUA_PATH
+
+CXX=${CXX:-clang++}
+LUA=${LUA:-lua}
+NODE=${NODE:-node}
+MODES=${MODES:-"tree_code flat_code basic_blocks"}
+
+dir=result/bench
+mkdir -p "$dir"
+
+echo "compiling tools..." >&2
+"$CXX" -std=c++11 -O2 bench/measure.cpp -o "$dir/measure"
+"$CXX" -Iruntime -std=c++11 -O2 $CXXFLAGS runtime/runtime.cpp -c -o "$dir/runtime.o"
+"$CXX" -std=c++11 -O2 $CXXFLAGS bench/allocations.cpp -c -o "$dir/allocations.o"
+
+# report program target mode prefix
+report() {
+  set -- "$1" "$2" "$3" "$4" `cat "$4-measure.txt"`
+  if test "X$3" = "X"
+  then
+    json_mode=null
+  else
+    json_mode="\"$3\""
+  fi
+  allocations=`awk '$1 == "allocations" { print $2 }' "$4-err.txt"`
+  if test "X$allocations" = "X"
+  then
+    allocations=null
+  fi
+  if diff "$dir/$1-expected.txt" "$4-out.txt" >/dev/null 2>&1
+  then
+    ok=true
+  else
+    ok=false
+  fi
+  printf '{"program":"%s","target":"%s","mode":%s,"seconds":%s,"max_rss_kb":%s,"allocations":%s,"status":%s,"ok":%s}\n' \
+    "$1" "$2" "$json_mode" "$5" "$6" "$allocations" "$7" "$ok"
+}
+
+if test $# -eq 0
+then
+  set -- bench/programs/*.lua
+else
+  for i in "$@"
+  do
+    shift
+    set -- "$@" "bench/programs/$i.lua"
+  done
+fi
+
+for i in "$@"
+do
+  j=`expr "X$i" : 'X.*/\([^/]*\)\.lua'`
+
+  echo "running $j (lua)..." >&2
+  p="$dir/$j-lua"
+  "$dir/measure" "$p-out.txt" "$p-err.txt" "$LUA" "$i" >"$p-measure.txt"
+  cp "$p-out.txt" "$dir/$j-expected.txt"
+  report "$j" lua "" "$p"
+
+  for mode in $MODES
+  do
+    p="$dir/$j-$mode"
+    echo "compiling $j ($mode)..." >&2
+    env MODE="$mode" NO_DUMP=1 "$LUA" test/compile.lua "$i" "$p"
+    "$CXX" -Iruntime -std=c++11 -O2 $CXXFLAGS "$p.cpp" "$dir/runtime.o" "$dir/allocations.o" -o "$p.exe"
+
+    echo "running $j (es, $mode)..." >&2
+    "$dir/measure" "$p-es-out.txt" "$p-es-err.txt" "$NODE" "$p.js" >"$p-es-measure.txt"
+    report "$j" es "$mode" "$p-es"
+
+    echo "running $j (cxx, $mode)..." >&2
+    "$dir/measure" "$p-cxx-out.txt" "$p-cxx-err.txt" "$p.exe" >"$p-cxx-measure.txt"
+    report "$j" cxx "$mode" "$p-cxx"
+  done
+done
@@ -0,0 +1,93 @@
+// Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+//
+// This file is part of dromozoa-compiler.
+//
+// dromozoa-compiler is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dromozoa-compiler is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+// usage: measure stdout stderr command [args...]
+//
+// runs the command with its standard output and error redirected to the
+// files, and prints the wall time in seconds, the peak resident set size in
+// kilobytes and the exit status, separated by tabs.
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+  int redirect(const char* path, int fd) {
+    int result = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (result == -1) {
+      return -1;
+    }
+    if (dup2(result, fd) == -1) {
+      return -1;
+    }
+    return close(result);
+  }
+}
+
+int main(int ac, char* av[]) {
+  if (ac < 4) {
+    std::fprintf(stderr, "usage: %s stdout stderr command [args...]\n", av[0]);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == -1) {
+    std::perror("fork");
+    return 1;
+  }
+  if (pid == 0) {
+    if (redirect(av[1], 1) == -1 || redirect(av[2], 2) == -1) {
+      std::perror("redirect");
+      _exit(127);
+    }
+    execvp(av[3], av + 3);
+    std::perror("execvp");
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage usage = {};
+  if (wait4(pid, &status, 0, &usage) == -1) {
+    std::perror("wait4");
+    return 1;
+  }
+  const auto stop = std::chrono::steady_clock::now();
+
+  long max_rss = usage.ru_maxrss;
+#ifdef __APPLE__
+  // bytes on darwin.
+  max_rss /= 1024;
+#endif
+
+  int result = 0;
+  if (WIFEXITED(status)) {
+    result = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    result = 128 + WTERMSIG(status);
+  }
+
+  std::printf("%.6f\t%ld\t%d\n", std::chrono::duration<double>(stop - start).count(), max_rss, result);
+  return 0;
+}
@@ -0,0 +1,52 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local function bottom_up_tree(depth)
+  if depth > 0 then
+    depth = depth - 1
+    return { bottom_up_tree(depth), bottom_up_tree(depth) }
+  else
+    return {}
+  end
+end
+
+local function item_check(tree)
+  if tree[1] then
+    return 1 + item_check(tree[1]) + item_check(tree[2])
+  else
+    return 1
+  end
+end
+
+local min_depth = 4
+local max_depth = 12
+
+local stretch_depth = max_depth + 1
+print(stretch_depth, item_check(bottom_up_tree(stretch_depth)))
+
+local long_lived_tree = bottom_up_tree(max_depth)
+
+for depth = min_depth, max_depth, 2 do
+  local iterations = 1 << (max_depth - depth + min_depth)
+  local check = 0
+  for _ = 1, iterations do
+    check = check + item_check(bottom_up_tree(depth))
+  end
+  print(iterations, depth, check)
+end
+
+print(max_depth, item_check(long_lived_tree))
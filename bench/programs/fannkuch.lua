@@ -0,0 +1,90 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local function fannkuch(n)
+  local p = {}
+  local q = {}
+  local s = {}
+  local sign = 1
+  local maxflips = 0
+  local sum = 0
+  for i = 1, n do
+    p[i] = i
+    q[i] = i
+    s[i] = i
+  end
+  while true do
+    -- copy and flip.
+    local q1 = p[1]
+    if q1 ~= 1 then
+      for i = 2, n do
+        q[i] = p[i]
+      end
+      local flips = 1
+      while true do
+        local qq = q[q1]
+        if qq == 1 then
+          sum = sum + sign * flips
+          if flips > maxflips then
+            maxflips = flips
+          end
+          break
+        end
+        q[q1] = q1
+        if q1 >= 4 then
+          local i = 2
+          local j = q1 - 1
+          repeat
+            q[i], q[j] = q[j], q[i]
+            i = i + 1
+            j = j - 1
+          until i >= j
+        end
+        q1 = qq
+        flips = flips + 1
+      end
+    end
+    -- permute.
+    if sign == 1 then
+      p[2], p[1] = p[1], p[2]
+      sign = -1
+    else
+      p[2], p[3] = p[3], p[2]
+      sign = 1
+      for i = 3, n do
+        local sx = s[i]
+        if sx ~= 1 then
+          s[i] = sx - 1
+          break
+        end
+        if i == n then
+          return sum, maxflips
+        end
+        s[i] = i
+        local t = p[1]
+        for j = 1, i do
+          p[j] = p[j + 1]
+        end
+        p[i + 1] = t
+      end
+    end
+  end
+end
+
+local n = 9
+local sum, flips = fannkuch(n)
+print(sum, flips)
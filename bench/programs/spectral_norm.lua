@@ -0,0 +1,69 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local function a(i, j)
+  local ij = i + j - 1
+  return 1 / (ij * (ij - 1) * 0.5 + i)
+end
+
+local function av(x, y, n)
+  for i = 1, n do
+    local sum = 0
+    for j = 1, n do
+      sum = sum + a(i, j) * x[j]
+    end
+    y[i] = sum
+  end
+end
+
+local function atv(x, y, n)
+  for i = 1, n do
+    local sum = 0
+    for j = 1, n do
+      sum = sum + a(j, i) * x[j]
+    end
+    y[i] = sum
+  end
+end
+
+local function atav(x, y, t, n)
+  av(x, t, n)
+  atv(t, y, n)
+end
+
+local n = 300
+local u = {}
+local v = {}
+local t = {}
+for i = 1, n do
+  u[i] = 1
+end
+for _ = 1, 10 do
+  atav(u, v, t, n)
+  atav(v, u, t, n)
+end
+local vbv = 0
+local vv = 0
+for i = 1, n do
+  local ui = u[i]
+  local vi = v[i]
+  vbv = vbv + ui * vi
+  vv = vv + vi * vi
+end
+
+-- the result is printed as an integer, in units of 1e-9.
+print((vbv / vv) ^ 0.5 * 1e9 // 1 | 0)
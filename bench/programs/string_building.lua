@@ -0,0 +1,54 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local function join(n)
+  local s = ""
+  for i = 1, n do
+    s = s .. tostring(i) .. ","
+  end
+  return s
+end
+
+local function checksum(s)
+  local sum = 0
+  for i = 1, #s, 7 do
+    sum = (sum * 31 + string.byte(s, i)) % 1000000007
+  end
+  return sum
+end
+
+local function split(s)
+  local n = 0
+  local i = 1
+  for j = 1, #s do
+    if s:sub(j, j) == "," then
+      n = n + #s:sub(i, j - 1)
+      i = j + 1
+    end
+  end
+  return n
+end
+
+local total = 0
+local sum = 0
+for _ = 1, 20 do
+  local s = join(2000)
+  total = total + #s
+  sum = (sum + checksum(s)) % 1000000007
+  total = total + split(s)
+end
+print(total, sum)
@@ -0,0 +1,44 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local function make(i)
+  return { id = i, name = "item", value = i * 2, tags = { i, i + 1, i + 2 } }
+end
+
+local sum = 0
+for round = 1, 50 do
+  local items = {}
+  for i = 1, 5000 do
+    items[#items + 1] = make(i + round)
+  end
+  for i = #items, 1, -1 do
+    local item = items[i]
+    sum = sum + item.value + item.tags[3]
+    if i % 3 == 0 then
+      items[i] = nil
+    end
+  end
+  local map = {}
+  for i = 1, 2000 do
+    map["key" .. i % 100] = i
+    map[i] = round
+  end
+  for i = 1, 100 do
+    sum = sum + map["key" .. i - 1]
+  end
+end
+print(sum)
@@ -41,8 +41,8 @@ function class:analyze()
   return analyze(self)
 end
 
-function class:generate()
-  return generate(self)
+function class:generate(opts)
+  return generate(self, opts)
 end
 
 function class:dump_protos(out, ...)
@@ -0,0 +1,342 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local operands = require "dromozoa.compiler.syntax_tree.operands"
+
+-- the instructions after which nothing runs in the block.
+local terminators = {
+  RETURN = true;
+  COND   = true;
+}
+
+-- the operands that the C++ backend copies into a new value_t, so that they
+-- can be moved instead at their last uses.
+local function movable(code, j)
+  local name = code[0]
+  if name == "MOVE" then
+    return j == 2
+  elseif name == "CALL" then
+    return j >= 3
+  else
+    return name == "RETURN"
+  end
+end
+
+local function allocate_registers(proto)
+  local captured = proto.captured
+  local basic_blocks = proto.basic_blocks
+  local g = basic_blocks.g
+  local u_after = g.u.after
+  local uv = g.uv
+  local uv_first = uv.first
+  local uv_after = uv.after
+  local uv_target = uv.target
+  local blocks = basic_blocks.blocks
+
+  local is_register, defines, first_use = operands(proto)
+
+  -- the registers that are allocated. the parameters keep their slots.
+  local function is_local(var)
+    return is_register(var) and not var:find "^A"
+  end
+
+  local function transfer(code, live)
+    if defines(code) then
+      live[code[1]] = nil
+    end
+    for j = first_use(code), #code do
+      local var = code[j]
+      if is_register(var) then
+        live[var] = true
+      end
+    end
+  end
+
+  local function live_out(uid, ins)
+    local live = {}
+    local eid = uv_first[uid]
+    while eid do
+      local data = ins[uv_target[eid]]
+      if data then
+        for var in pairs(data) do
+          live[var] = true
+        end
+      end
+      eid = uv_after[eid]
+    end
+    return live
+  end
+
+  local ins = {}
+  local changed = true
+  while changed do
+    changed = false
+    local uid = g.u.first
+    while uid do
+      local live = live_out(uid, ins)
+      local block = blocks[uid]
+      for i = #block, 1, -1 do
+        transfer(block[i], live)
+      end
+      local data = ins[uid]
+      if not data then
+        data = {}
+        ins[uid] = data
+      end
+      for var in pairs(live) do
+        if not data[var] then
+          data[var] = true
+          changed = true
+        end
+      end
+      uid = u_after[uid]
+    end
+  end
+
+  -- a register interferes with the registers that are live where it is
+  -- written. the registers live at the entry are written nil there.
+  local vars = {}
+  local edges = {}
+  local function add_var(var)
+    if not edges[var] then
+      vars[#vars + 1] = var
+      edges[var] = {}
+    end
+  end
+  local function add_edges(var, live)
+    for that in pairs(live) do
+      if that ~= var and edges[that] then
+        edges[var][that] = true
+        edges[that][var] = true
+      end
+    end
+  end
+
+  -- the blocks in the loops, found as the strongly connected components.
+  -- the slots in the loops are not cleared since they are written again by
+  -- the next iteration.
+  local loops = {}
+  local index = 0
+  local indices = {}
+  local lowlinks = {}
+  local stack = {}
+  local on_stack = {}
+  local function visit(uid)
+    index = index + 1
+    indices[uid] = index
+    lowlinks[uid] = index
+    stack[#stack + 1] = uid
+    on_stack[uid] = true
+    local eid = uv_first[uid]
+    while eid do
+      local vid = uv_target[eid]
+      if vid == uid then
+        loops[uid] = true
+      end
+      if not indices[vid] then
+        visit(vid)
+        if lowlinks[uid] > lowlinks[vid] then
+          lowlinks[uid] = lowlinks[vid]
+        end
+      elseif on_stack[vid] and lowlinks[uid] > indices[vid] then
+        lowlinks[uid] = indices[vid]
+      end
+      eid = uv_after[eid]
+    end
+    if lowlinks[uid] == indices[uid] then
+      local n = #stack
+      local vid = stack[n]
+      if vid ~= uid then
+        loops[uid] = true
+      end
+      repeat
+        vid = stack[n]
+        stack[n] = nil
+        n = n - 1
+        on_stack[vid] = nil
+        if vid ~= uid then
+          loops[vid] = true
+        end
+      until vid == uid
+    end
+  end
+  local uid = g.u.first
+  while uid do
+    if not indices[uid] then
+      visit(uid)
+    end
+    uid = u_after[uid]
+  end
+
+  -- the dying registers, for the clears. a boxed register that dies at an
+  -- operand read only once by the code is moved from.
+  local deaths = {}
+
+  uid = g.u.first
+  while uid do
+    local live = live_out(uid, ins)
+    for var in pairs(live) do
+      if is_local(var) then
+        add_var(var)
+      end
+    end
+    local block = blocks[uid]
+    for i = #block, 1, -1 do
+      local code = block[i]
+      local counts = {}
+      for j = 1, #code do
+        local var = code[j]
+        if is_register(var) then
+          counts[var] = (counts[var] or 0) + 1
+          if is_local(var) then
+            add_var(var)
+          end
+        end
+      end
+      local def = defines(code) and code[1]
+      if def and is_local(def) then
+        add_edges(def, live)
+      end
+      local unboxed = code.unboxed
+      local moves
+      local dying
+      for j = first_use(code), #code do
+        local var = code[j]
+        if is_register(var) and not live[var] and not (unboxed and unboxed[j]) and var ~= def then
+          if counts[var] == 1 and movable(code, j) then
+            if not moves then
+              moves = {}
+              code.moves = moves
+            end
+            moves[j] = true
+          elseif is_local(var) and not terminators[code[0]] and not loops[uid] then
+            if not dying then
+              dying = {}
+              deaths[code] = dying
+            end
+            dying[var] = true
+          end
+        end
+      end
+      transfer(code, live)
+    end
+    uid = u_after[uid]
+  end
+
+  local entry = ins[basic_blocks.entry_uid] or {}
+  for var in pairs(entry) do
+    if is_local(var) then
+      add_var(var)
+      add_edges(var, entry)
+    end
+  end
+
+  table.sort(vars, function (a, b)
+    local x = a:sub(1, 1)
+    local y = b:sub(1, 1)
+    if x == y then
+      return tonumber(a:sub(2)) < tonumber(b:sub(2))
+    else
+      return x < y
+    end
+  end)
+
+  -- greedy coloring in the order of the registers. the slots of the
+  -- captured locals are reserved.
+  local reserved = { B = {}, C = {} }
+  local counts = { B = 0, C = 0 }
+  for var in pairs(captured) do
+    local key = var:sub(1, 1)
+    if key == "B" then
+      local n = tonumber(var:sub(2))
+      reserved.B[n] = true
+      if counts.B <= n then
+        counts.B = n + 1
+      end
+    end
+  end
+  local names = {}
+  for i = 1, #vars do
+    local var = vars[i]
+    local key = var:sub(1, 1)
+    local used = {}
+    for that in pairs(edges[var]) do
+      local name = names[that]
+      if name and name:sub(1, 1) == key then
+        used[tonumber(name:sub(2))] = true
+      end
+    end
+    local n = 0
+    while used[n] or reserved[key][n] do
+      n = n + 1
+    end
+    names[var] = key .. n
+    if counts[key] <= n then
+      counts[key] = n + 1
+    end
+  end
+  proto.B = counts.B
+  proto.C = counts.C
+
+  uid = g.u.first
+  while uid do
+    local block = blocks[uid]
+    for i = 1, #block do
+      local code = block[i]
+      local cond = code.cond
+      for j = 1, #code do
+        local name = names[code[j]]
+        if name then
+          code[j] = name
+          if cond then
+            cond[j] = name
+          end
+        end
+      end
+    end
+    -- the slots are cleared after their last uses, unless the next code
+    -- writes them anyway.
+    for i = 1, #block do
+      local code = block[i]
+      local dying = deaths[code]
+      if dying then
+        local def = defines(code) and code[1]
+        local next_code = block[i + 1]
+        local next_def = next_code and defines(next_code) and next_code[1]
+        local clears = {}
+        for var in pairs(dying) do
+          local name = names[var]
+          if name ~= def and name ~= next_def then
+            clears[#clears + 1] = name
+          end
+        end
+        if #clears > 0 then
+          table.sort(clears)
+          code.clears = clears
+        end
+      end
+    end
+    uid = u_after[uid]
+  end
+end
+
+return function (self)
+  local protos = self.protos
+  for i = 1, #protos do
+    allocate_registers(protos[i])
+  end
+end
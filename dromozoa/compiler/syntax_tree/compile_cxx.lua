@@ -15,8 +15,11 @@
 -- You should have received a copy of the GNU General Public License
 -- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
 
+local number_type = require "dromozoa.compiler.syntax_tree.number_type"
 local template = require "dromozoa.compiler.syntax_tree.template"
 
+local math_type = math.type
+
 local char_table = {
   ["\""] = [[\"]];
   ["\\"] = [[\\]];
@@ -42,10 +45,58 @@ local function encode_string(s)
   return "\"" .. s:gsub("[%z\1-\31\127]", char_table) .. "\""
 end
 
+-- the hosts before Lua 5.3 read the integers as floats, so the integers are
+-- written from their sources there. a hexadecimal wraps around.
+local function encode_integer(source)
+  if math_type then
+    local v = tonumber(source)
+    if v == math.mininteger then
+      return "INT64_MIN"
+    else
+      return ("INT64_C(%d)"):format(v)
+    end
+  end
+  local hex = source:match "^0[xX](%x+)$"
+  if hex then
+    return ("static_cast<std::int64_t>(UINT64_C(0x%s))"):format(hex:sub(-16))
+  end
+  return ("INT64_C(%s)"):format((source:gsub("^0+(%d)", "%1")))
+end
+
+local function encode_number(v)
+  if v == math.huge then
+    return "HUGE_VAL"
+  else
+    local s = ("%.17g"):format(v)
+    if s:find "^%-?%d+$" then
+      s = s .. ".0"
+    end
+    return s
+  end
+end
+
+-- a numeric constant from its source.
+local function encode_constant(source)
+  if number_type(source) == "integer" then
+    return encode_integer(source)
+  else
+    return encode_number(tonumber(source))
+  end
+end
+
+-- the registers of the proto being compiled that closures capture, mapped to
+-- their slots in H.
+local shared_vars
+
+-- the kinds of the registers that the code being compiled refers to.
+local referenced
+
 local function encode_var(var)
   local result = var_table[var]
   if result then
     return result
+  elseif shared_vars and shared_vars[var] then
+    return "H[" .. shared_vars[var] .. "]"
   else
     local key = var:sub(1, 1)
     if key == "L" or key == "M" then
@@ -55,11 +106,101 @@ local function encode_var(var)
     elseif key == "U" then
       return "(*U[" .. var:sub(2) .. "])"
     else
+      if referenced then
+        referenced[key] = true
+      end
       return key .. "[" .. var:sub(2) .. "]"
     end
   end
 end
 
+-- the numeric constants of the proto being compiled.
+local literals
+
+-- the operand i of the code, which may be unboxed.
+local function encode_operand(code, i)
+  local unboxed = code.unboxed
+  return encode_var(unboxed and unboxed[i] or code[i])
+end
+
+-- the operand i of the code as a value_t.
+local function encode_value(code, i)
+  local unboxed = code.unboxed
+  local var = unboxed and unboxed[i]
+  if var then
+    return "value_t(" .. encode_var(var) .. ")"
+  else
+    return encode_var(code[i])
+  end
+end
+
+-- the operand i of the code as a value_t to be copied. the register is moved
+-- from at its last use.
+local function encode_copy(code, i)
+  local moves = code.moves
+  if moves and moves[i] then
+    return "std::move(" .. encode_var(code[i]) .. ")"
+  else
+    return encode_value(code, i)
+  end
+end
+
+local fields = {
+  integer = "integer";
+  float = "number";
+  boolean = "boolean";
+}
+
+-- the operand i of the code as a std::int64_t, a double or a bool. t is the
+-- type of the operand.
+local function encode_raw(code, i, t)
+  local unboxed = code.unboxed
+  local var = unboxed and unboxed[i]
+  if var then
+    return encode_var(var)
+  end
+  var = code[i]
+  if var == "TRUE" then
+    return "true"
+  elseif var == "FALSE" then
+    return "false"
+  end
+  local literal = literals[var]
+  if literal then
+    return encode_constant(literal)
+  end
+  return encode_var(var) .. "." .. fields[t]
+end
+
+-- the operand i of the code, an integer or a float, as a double.
+local function encode_float(code, i, t)
+  if t == "float" then
+    return encode_raw(code, i, t)
+  end
+  local literal = literals[code[i]]
+  if literal and math_type and not (code.unboxed and code.unboxed[i]) then
+    return encode_number(tonumber(literal) + 0.0)
+  end
+  return "static_cast<double>(" .. encode_raw(code, i, t) .. ")"
+end
+
+local function encode_cond(code, i)
+  local types = code.types
+  local cond
+  if code[i] == "TRUE" or code[i] == "FALSE" then
+    cond = code[i]:lower()
+  elseif types and types[i] == "boolean" then
+    cond = encode_raw(code, i, "boolean")
+  else
+    cond = encode_value(code, i) .. ".toboolean()"
+  end
+  if code[i + 1] == "TRUE" then
+    return cond
+  else
+    return "!" .. cond
+  end
+end
+
 local function encode_vars(source, i, j)
   if not i then
     i = 1
@@ -69,10 +210,15 @@ local function encode_vars(source, i, j)
   end
   local result = {}
   for i = i, j do
-    result[#result + 1] = encode_var(source[i])
+    result[#result + 1] = encode_copy(source, i)
   end
   local var = result[#result]
   if var == "V" or var == "T" then
+    -- the results of the last call are not used again, nor are the varargs
+    -- after the return.
+    if var == "T" or source[0] == "RETURN" then
+      var = "std::move(" .. var .. ")"
+    end
     result[#result] = nil
     if #result == 0 then
       return var
@@ -88,37 +234,233 @@ local function encode_vars(source, i, j)
   end
 end
 
-local tmpl = template(encode_var, {
+-- the arguments of the direct call, one for each parameter of the callee.
+-- the missing ones are nil and the extra ones are dropped.
+local function encode_args(self, code)
+  local proto = self.protos[code.callee:sub(2) + 1]
+  local result = {}
+  for i = 1, proto.A do
+    if code[i + 2] then
+      result[i] = encode_copy(code, i + 2)
+    else
+      result[i] = "NIL"
+    end
+  end
+  return table.concat(result, ", ")
+end
+
+local function encode_upvalues(proto)
+  local upvalues = proto.upvalues
+  local result = {}
+  for i = 1, #upvalues do
+    local var = upvalues[i][2]
+    local key = var:sub(1, 1)
+    if key == "U" then
+      result[i] = ("U[%d]"):format(var:sub(2))
+    elseif shared_vars then
+      result[i] = ("{ H, %d }"):format(shared_vars[var])
+    else
+      result[i] = ("{ %s, %d }"):format(key, var:sub(2))
+    end
+  end
+  if #result == 0 then
+    return "uparray_t {}"
+  else
+    return "uparray_t { " .. table.concat(result, ", ") .. " }"
+  end
+end
+
+local tmpl = template(function (_, code, i)
+  if i == 1 and code[0] ~= "SETTABLE" then
+    return encode_operand(code, i)
+  else
+    return encode_copy(code, i)
+  end
+end, {
   MOVE     = "%1 = %2";
   GETTABLE = "%1 = gettable(%2, %3)";
   SETTABLE = "settable(%1, %2, %3)";
   NEWTABLE = "%1 = type_t::table";
-  ADD      = "%1 = %2.checknumber() + %3.checknumber()";
-  SUB      = "%1 = %2.checknumber() - %3.checknumber()";
-  MUL      = "%1 = %2.checknumber() * %3.checknumber()";
-  MOD      = "%1 = std::fmod(%2.checknumber(), %3.checknumber())";
-  POW      = "%1 = std::pow(%2.checknumber(), %3.checknumber())";
-  DIV      = "%1 = %2.checknumber() / %3.checknumber()";
-  IDIV     = "%1 = std::floor(%2.checknumber() / %3.checknumber())";
-  BAND     = "%1 = %2.checkinteger() & %3.checkinteger()";
-  BOR      = "%1 = %2.checkinteger() | %3.checkinteger()";
-  BXOR     = "%1 = %2.checkinteger() ^ %3.checkinteger()";
-  SHL      = "%1 = %2.checkinteger() << %3.checkinteger()";
-  SHR      = "%1 = %2.checkinteger() >> %3.checkinteger()";
-  UNM      = "%1 = -%2.checknumber()";
-  BNOT     = "%1 = ~%2.checkinteger()";
+  ADD      = "%1 = add(%2, %3)";
+  SUB      = "%1 = sub(%2, %3)";
+  MUL      = "%1 = mul(%2, %3)";
+  MOD      = "%1 = mod(%2, %3)";
+  POW      = "%1 = pow(%2, %3)";
+  DIV      = "%1 = div(%2, %3)";
+  IDIV     = "%1 = idiv(%2, %3)";
+  BAND     = "%1 = band(%2, %3)";
+  BOR      = "%1 = bor(%2, %3)";
+  BXOR     = "%1 = bxor(%2, %3)";
+  SHL      = "%1 = shl(%2, %3)";
+  SHR      = "%1 = shr(%2, %3)";
+  UNM      = "%1 = unm(%2)";
+  BNOT     = "%1 = bnot(%2)";
   NOT      = "%1 = !%2.toboolean()";
   LEN      = "%1 = len(%2)";
-  CONCAT   = "%1 = %2.checkstring() + %3.checkstring()";
   EQ       = "%1 = eq(%2, %3)";
   NE       = "%1 = !eq(%2, %3)";
   LT       = "%1 = lt(%2, %3)";
   LE       = "%1 = le(%2, %3)";
   BREAK    = "break";
   GOTO     = "goto %1";
-  TONUMBER = "%1 = %2.checknumber()";
+  TONUMBER = "%1 = tonumber(%2)";
 })
 
+-- the instructions whose operands are known to be integers, floats or
+-- booleans are compiled to plain C++ operations. the operations on integers
+-- wrap around.
+local integer_rules = {
+  ADD  = "add(%s, %s)";
+  SUB  = "sub(%s, %s)";
+  MUL  = "mul(%s, %s)";
+  MOD  = "mod(%s, %s)";
+  IDIV = "idiv(%s, %s)";
+  BAND = "%s & %s";
+  BOR  = "%s | %s";
+  BXOR = "%s ^ %s";
+  SHL  = "shl(%s, %s)";
+  SHR  = "shr(%s, %s)";
+  EQ   = "%s == %s";
+  NE   = "%s != %s";
+  LT   = "%s < %s";
+  LE   = "%s <= %s";
+  MOVE = "%s";
+  UNM  = "unm(%s)";
+  BNOT = "~%s";
+  NOT  = "false";
+  TONUMBER = "%s";
+}
+
+-- the operands are converted to double.
+local float_rules = {
+  ADD  = "%s + %s";
+  SUB  = "%s - %s";
+  MUL  = "%s * %s";
+  MOD  = "mod(%s, %s)";
+  POW  = "std::pow(%s, %s)";
+  DIV  = "%s / %s";
+  IDIV = "std::floor(%s / %s)";
+  EQ   = "%s == %s";
+  NE   = "%s != %s";
+  LT   = "%s < %s";
+  LE   = "%s <= %s";
+  MOVE = "%s";
+  UNM  = "-%s";
+  NOT  = "false";
+  TONUMBER = "%s";
+}
+
+local boolean_rules = {
+  EQ   = "%s == %s";
+  NE   = "%s != %s";
+  MOVE = "%s";
+  NOT  = "!%s";
+}
+
+local compare_names = {
+  EQ = true;
+  NE = true;
+  LT = true;
+  LE = true;
+}
+
+local unboxed_types = {
+  I = "integer";
+  N = "float";
+  F = "boolean";
+}
+
+local function compile_typed(code)
+  local name = code[0]
+  local types = code.types or {}
+  local unboxed = code.unboxed
+  local x = types[2]
+  local y = types[3]
+  if name == "MOVE" and not x and unboxed and unboxed[1] then
+    -- no definition reaches the source, so the code is unreachable.
+    x = unboxed_types[unboxed[1]:sub(1, 1)]
+  end
+  if not x or (code[3] and not y) then
+    return
+  end
+  if not code[3] then
+    y = x
+  end
+
+  local rule
+  local encode = encode_raw
+  if x == "integer" and y == "integer" then
+    rule = integer_rules[name]
+  end
+  if not rule and x ~= "boolean" and y ~= "boolean" and (x == y or not compare_names[name]) then
+    -- an integer and a float are compared exactly by the runtime.
+    rule = float_rules[name]
+    encode = encode_float
+  end
+  if x == "boolean" and y == "boolean" then
+    rule = boolean_rules[name]
+  end
+  if rule then
+    return ("%s = " .. rule):format(encode_operand(code, 1), encode(code, 2, x), code[3] and encode(code, 3, y))
+  end
+end
+
+-- a numeric for whose index is unboxed is compiled to a native for. returns
+-- the declaration of the limit and the header of the for.
+local function compile_fornum(code)
+  local fornum = code.fornum
+  local add = fornum.add
+  local lt = fornum.lt
+  if code[1] ~= add or add[0] ~= "ADD" or lt[0] ~= "LT" then
+    return
+  end
+  local index = add.unboxed and add.unboxed[1]
+  local types = add.types
+  if not index or not types or not compile_typed(add) then
+    return
+  end
+  local t = lt.types and lt.types[2]
+  local i = encode_var(index)
+  local step
+  local limit
+  local decl
+  local cond
+  local literal = literals[add[3]]
+  if index:find "^I" then
+    step = encode_raw(add, 3, "integer")
+    if t == "integer" then
+      limit = encode_raw(lt, 2, t)
+    else
+      limit = ("forlimit(%s, %s)"):format(encode_value(lt, 2), step)
+    end
+    decl = "const std::int64_t limit = " .. limit
+    if not literal then
+      cond = ("(0 <= %s ? %s <= limit : limit <= %s)"):format(step, i, i)
+    elseif tonumber(literal) < 0 then
+      cond = ("limit <= %s"):format(i)
+    else
+      cond = ("%s <= limit"):format(i)
+    end
+  else
+    step = encode_float(add, 3, types[3])
+    if t == "integer" or t == "float" then
+      limit = encode_float(lt, 2, t)
+    else
+      limit = encode_value(lt, 2) .. ".tofloat()"
+    end
+    decl = "const double limit = " .. limit
+    if not literal then
+      cond = ("!(0 <= %s ? limit < %s : %s < 0 && %s < limit)"):format(step, i, step, i)
+    elseif tonumber(literal) < 0 then
+      cond = ("!(%s < limit)"):format(i)
+    else
+      cond = ("!(limit < %s)"):format(i)
+    end
+  end
+  local next = compile_typed(add)
+  return decl, ("for (%s; %s; %s)"):format(next, cond, next)
+end
+
 local compile_code
 
 local function write_block(self, out, code, indent, opts)
@@ -131,14 +473,30 @@ function compile_code(self, out, code, indent, opts)
   local name = code[0]
   if code.block then
     if name == "LOOP" then
-      out:write(indent, "for (;;) {\n")
-      write_block(self, out, code, indent .. "  ", opts)
-      out:write(indent, "}\n")
+      local decl, header
+      if code.fornum then
+        decl, header = compile_fornum(code)
+      end
+      if decl then
+        out:write(indent, "{\n")
+        out:write(indent, "  ", decl, ";\n")
+        out:write(indent, "  ", header, " {\n")
+        local head = code.fornum.head
+        for i = 1, #code do
+          local that = code[i]
+          if not head[that] then
+            compile_code(self, out, that, indent .. "    ", opts)
+          end
+        end
+        out:write(indent, "  }\n")
+        out:write(indent, "}\n")
+      else
+        out:write(indent, "for (;;) {\n")
+        write_block(self, out, code, indent .. "  ", opts)
+        out:write(indent, "}\n")
+      end
     elseif name == "COND" then
-      local cond = code[1]
-      out:write(indent, ("if (%s%s.toboolean()) {\n"):format(
-          cond[2] == "TRUE" and "" or "!",
-          encode_var(cond[1])))
+      out:write(indent, ("if (%s) {\n"):format(encode_cond(code[1], 1)))
       write_block(self, out, code[2], indent .. "  ", opts)
       if #code == 2 then
         out:write(indent, "}\n")
@@ -151,14 +509,24 @@ function compile_code(self, out, code, indent, opts)
       write_block(self, out, code, indent, opts)
     end
   else
-    if name == "CALL" then
+    if name == "CALL" and code.callee then
+      local var = code[1]
+      local call = ("static_cast<%s&>(*%s.function).invoke(%s)"):format(code.callee, encode_operand(code, 2), encode_args(self, code))
+      if var == "NIL" then
+        out:write(indent, call, ";\n")
+      elseif var == "T" then
+        out:write(indent, ("T = %s;\n"):format(call))
+      else
+        out:write(indent, ("%s = first(%s);\n"):format(encode_operand(code, 1), call))
+      end
+    elseif name == "CALL" then
       local var = code[1]
       if var == "NIL" then
-        out:write(indent, ("call0(%s, %s);\n"):format(encode_var(code[2]), encode_vars(code, 3)))
+        out:write(indent, ("call0(%s, %s);\n"):format(encode_operand(code, 2), encode_vars(code, 3)))
       elseif var == "T" then
-        out:write(indent, ("T = call(%s, %s);\n"):format(encode_var(code[2]), encode_vars(code, 3)))
+        out:write(indent, ("T = call(%s, %s);\n"):format(encode_operand(code, 2), encode_vars(code, 3)))
       else
-        out:write(indent, ("%s = call1(%s, %s);\n"):format(encode_var(var), encode_var(code[2]), encode_vars(code, 3)))
+        out:write(indent, ("%s = call1(%s, %s);\n"):format(encode_operand(code, 1), encode_operand(code, 2), encode_vars(code, 3)))
       end
     elseif name == "RETURN" then
       local n = #code
@@ -168,38 +536,74 @@ function compile_code(self, out, code, indent, opts)
         out:write(indent, ("return %s;\n"):format(encode_vars(code)))
       end
     elseif name == "SETLIST" then
-      out:write(indent, ("setlist(%s, %d, %s);\n"):format(encode_var(code[1]), code[2], encode_var(code[3])))
+      out:write(indent, ("setlist(%s, %d, %s);\n"):format(encode_operand(code, 1), code[2], encode_operand(code, 3)))
     elseif name == "CLOSURE" then
-      out:write(indent, ("%s = std::make_shared<%s>(U, A, B);\n"):format(encode_var(code[1]), code[2]))
+      local proto = self.protos[code[2]:sub(2) + 1]
+      out:write(indent, ("%s = make_ptr<%s>(%s);\n"):format(encode_var(code[1]), code[2], encode_upvalues(proto)))
     elseif name == "LABEL" then
       out:write(("  %s:\n"):format(code[1]))
     elseif name == "COND" then
-      out:write(indent, ("if (%s%s.toboolean()) goto %s; else goto %s;\n"):format(
-          code[2] == "TRUE" and "" or "!",
-          encode_var(code[1]),
-          code[3],
-          code[4]))
+      out:write(indent, ("if (%s) goto %s; else goto %s;\n"):format(encode_cond(code, 1), code[3], code[4]))
+    elseif name == "CONCAT" then
+      local operands = {}
+      for i = 2, #code do
+        operands[#operands + 1] = encode_value(code, i)
+      end
+      out:write(indent, ("%s = concat(%s);\n"):format(encode_operand(code, 1), table.concat(operands, ", ")))
+    elseif name == "GETTABLE" and code.cache then
+      out:write(indent, ("%s = getfield(%s, %s, K->caches[%d]);\n"):format(encode_operand(code, 1), encode_value(code, 2), encode_var(code[3]), code.cache))
+    elseif name == "SETTABLE" and code.cache then
+      out:write(indent, ("setfield(%s, %s, %s, K->caches[%d]);\n"):format(encode_value(code, 1), encode_var(code[2]), encode_value(code, 3), code.cache))
     else
-      out:write(indent, tmpl:eval(name, code), ";\n")
+      out:write(indent, compile_typed(code) or tmpl:eval(name, code), ";\n")
+    end
+    local clears = code.clears
+    if clears then
+      for i = 1, #clears do
+        out:write(indent, ("%s = NIL;\n"):format(encode_var(clears[i])))
+      end
     end
   end
 end
 
+-- the field accesses with constant string keys get inline caches, which live
+-- in the constants of the proto.
+local function assign_caches(proto)
+  local strings = {}
+  local constants = proto.constants
+  for i = 1, #constants do
+    local constant = constants[i]
+    if constant.type == "string" then
+      strings[constant[1]] = true
+    end
+  end
+
+  local n = 0
+  local basic_blocks = proto.basic_blocks
+  local blocks = basic_blocks.blocks
+  local u_after = basic_blocks.g.u.after
+  local uid = basic_blocks.g.u.first
+  while uid do
+    local block = blocks[uid]
+    for i = 1, #block do
+      local code = block[i]
+      local name = code[0]
+      if name == "GETTABLE" and strings[code[3]] or name == "SETTABLE" and strings[code[2]] then
+        code.cache = n
+        n = n + 1
+      end
+    end
+    uid = u_after[uid]
+  end
+  return n
+end
+
 local function compile_constants(self, out, proto, opts)
   local name = proto[1]
   local constants = proto.constants
   local n = #constants
 
   if n == 0 then
-    out:write(([[
-
-struct %s_constants {
-  static const %s_constants* get() {
-    static const %s_constants instance;
-    return &instance;
-  }
-};
-]]):format(name, name, name))
     return
   end
 
@@ -211,11 +615,16 @@ struct %s_constants {
     decls[i] = ("const value_t %s"):format(name)
     if constant.type == "string" then
       local source = constant.source
-      inits[i] = ("%s(%s, %d)"):format(name, encode_string(source), #source)
+      inits[i] = ("%s(intern(%s, %d))"):format(name, encode_string(source), #source)
     else
-      inits[i] = ("%s(%.17g)"):format(name, tonumber(constant.source))
+      inits[i] = ("%s(%s)"):format(name, encode_constant(constant.source))
     end
   end
+  local caches = assign_caches(proto)
+  if caches > 0 then
+    decls[#decls + 1] = ("mutable cache_t caches[%d]"):format(caches)
+    inits[#inits + 1] = "caches()"
+  end
 
   out:write(([[
 
@@ -224,12 +633,9 @@ struct %s_constants {
 
   %s_constants()
     : %s {}
-
-  static const %s_constants* get() {
-    static const %s_constants instance;
-    return &instance;
-  }
 };
+
+const %s_constants %s_K;
 ]]):format(
     name,
     template.concat(decls, ";\n  "),
@@ -239,169 +645,306 @@ struct %s_constants {
     name))
 end
 
+local function compile_basic_blocks(self, out, proto, indent, opts)
+  local basic_blocks = proto.basic_blocks
+  local g = basic_blocks.g
+  local u = g.u
+  local u_after = u.after
+  local uv = g.uv
+  local uv_first = uv.first
+  local uv_after = uv.after
+  local uv_target = uv.target
+  local entry_uid = basic_blocks.entry_uid
+  local exit_uid = basic_blocks.exit_uid
+  local blocks = basic_blocks.blocks
+
+  -- the blocks are laid out in order and jump to each other by goto, so
+  -- that loops run in a constant stack space. a block falls through to the
+  -- next one if it can.
+  local uids = {}
+  local uid = u.first
+  while uid do
+    if uid ~= exit_uid then
+      uids[#uids + 1] = uid
+    end
+    uid = u_after[uid]
+  end
+
+  local function terminator(block)
+    for i = 1, #block do
+      local name = block[i][0]
+      if name == "RETURN" or name == "COND" then
+        return i, name
+      end
+    end
+    return #block + 1
+  end
+
+  local labels = {}
+  if uids[1] ~= entry_uid then
+    labels[entry_uid] = true
+  end
+  for i = 1, #uids do
+    local uid = uids[i]
+    local _, name = terminator(blocks[uid])
+    local eid = uv_first[uid]
+    if name == "COND" then
+      labels[uv_target[eid]] = true
+      labels[uv_target[uv_after[eid]]] = true
+    elseif not name and uv_target[eid] ~= uids[i + 1] then
+      labels[uv_target[eid]] = true
+    end
+  end
+
+  local function jump(uid)
+    if uid == exit_uid then
+      return "return {}"
+    else
+      return ("goto BB%d"):format(uid)
+    end
+  end
+
+  if labels[entry_uid] and uids[1] ~= entry_uid then
+    out:write(indent, jump(entry_uid), ";\n")
+  end
+  for i = 1, #uids do
+    local uid = uids[i]
+    local block = blocks[uid]
+    if labels[uid] then
+      out:write(("  BB%d:\n"):format(uid))
+    end
+    local n, name = terminator(block)
+    for j = 1, n - 1 do
+      compile_code(self, out, block[j], indent, opts)
+    end
+    local code = block[n]
+    local eid = uv_first[uid]
+    if name == "RETURN" then
+      out:write(indent, ("return %s;\n"):format(encode_vars(code)))
+    elseif name == "COND" then
+      out:write(indent, ("if (%s) %s; else %s;\n"):format(encode_cond(code, 1), jump(uv_target[eid]), jump(uv_target[uv_after[eid]])))
+    elseif uv_target[eid] ~= uids[i + 1] then
+      out:write(indent, jump(uv_target[eid]), ";\n")
+    end
+  end
+end
+
 local function compile_codes(self, out, proto, opts)
   out:write [[
 
   array_t entry() {
 ]]
 
-  if opts.mode == "flat_code" then
-    compile_code(self, out, proto.flat_code, "    ", opts)
+  -- the body is compiled first, so that only the unboxed registers that it
+  -- refers to are declared. a native for does not compile the head of its
+  -- loop, whose result may be the only boolean.
+  local body = {}
+  local buffer = {}
+  function buffer:write(...)
+    for i = 1, select("#", ...) do
+      body[#body + 1] = select(i, ...)
+    end
+  end
+
+  referenced = {}
+  if opts.mode == "basic_blocks" then
+    compile_basic_blocks(self, buffer, proto, "    ", opts)
+  elseif opts.mode == "flat_code" then
+    compile_code(self, buffer, proto.flat_code, "    ", opts)
   else
-    compile_code(self, out, proto.tree_code, "    ", opts)
+    compile_code(self, buffer, proto.tree_code, "    ", opts)
+  end
+
+  if proto.I > 0 and referenced.I then
+    out:write(("    std::int64_t I[%d] = {};\n"):format(proto.I))
   end
+  if proto.N > 0 and referenced.N then
+    out:write(("    double N[%d] = {};\n"):format(proto.N))
+  end
+  if proto.F > 0 and referenced.F then
+    out:write(("    bool F[%d] = {};\n"):format(proto.F))
+  end
+  referenced = nil
 
+  out:write(table.concat(body))
   out:write [[
     return {};
   }
 ]]
 end
 
-local function compile_basic_block(self, out, basic_blocks, uid, block, indent, opts)
-  out:write(([[
-
-  array_t BB%d() {
-]]):format(uid))
+local function compile_program(self, out, proto, opts)
+  local name = proto[1]
+  local captured = proto.captured
 
-  local code
-  local name
-  for i = 1, #block do
-    code = block[i]
-    name = code[0]
-    if name == "RETURN" or name == "COND" then
-      break
-    else
-      compile_code(self, out, code, indent, opts)
+  literals = {}
+  local constants = proto.constants
+  for i = 1, #constants do
+    local constant = constants[i]
+    if constant.type ~= "string" then
+      literals[constant[1]] = constant.source
     end
   end
 
-  if name == "RETURN" then
-    out:write(indent, ("return BB%d(%s);\n"):format(basic_blocks.exit_uid, encode_vars(code)))
-  else
-    local g = basic_blocks.g
-    local uv = g.uv
-    local uv_target = uv.target
-    local eid = uv.first[uid]
-    if name == "COND" then
-      local then_uid = uv_target[eid]
-      eid = uv.after[eid]
-      out:write(indent, ("if (%s%s.toboolean()) return BB%d(); else return BB%d();\n"):format(
-          code[2] == "TRUE" and "" or "!",
-          encode_var(code[1]),
-          then_uid,
-          uv_target[eid]))
-    else
-      out:write(indent, ("return BB%d();\n"):format(uv_target[eid]))
+  local decls = {}
+  local inits = {}
+  if #proto.constants > 0 then
+    decls[1] = ("static constexpr const %s_constants* K = &%s_K"):format(name, name)
+  end
+  decls[#decls + 1] = "uparray_t U"
+  inits[#inits + 1] = "U(U)"
+
+  -- the direct calls pass the arguments as parameters, which are moved to A
+  -- unless they are captured.
+  local params = { "uparray_t U" }
+  local direct_inits = { "U(U)" }
+
+  -- the program lives on the stack. only the registers that closures
+  -- capture are moved to H, which the closures share.
+  local n = proto.A
+  local shared = {}
+  local shared_inits = {}
+  local direct_shared_inits = {}
+  if n > 0 then
+    decls[#decls + 1] = ("value_t A[%d]"):format(n)
+    local args = {}
+    local direct_args = {}
+    for i = 1, n do
+      local arg = ("args[%d]"):format(i - 1)
+      local param = ("a%d"):format(i - 1)
+      args[i] = arg
+      params[i + 1] = "value_t " .. param
+      if captured["A" .. i - 1] then
+        shared["A" .. i - 1] = #shared_inits
+        shared_inits[#shared_inits + 1] = arg
+        direct_shared_inits[#direct_shared_inits + 1] = param
+        direct_args[i] = param
+      else
+        direct_args[i] = "std::move(" .. param .. ")"
+      end
     end
+    inits[#inits + 1] = ("A { %s }"):format(table.concat(args, ", "))
+    direct_inits[#direct_inits + 1] = ("A { %s }"):format(table.concat(direct_args, ", "))
+  end
+  if proto.vararg then
+    decls[#decls + 1] = "array_t V"
+    inits[#inits + 1] = ("V(args.sub(%d))"):format(n)
+  end
+  if proto.B > 0 then
+    decls[#decls + 1] = ("value_t B[%d]"):format(proto.B)
+    for i = 1, proto.B do
+      if captured["B" .. i - 1] then
+        shared["B" .. i - 1] = #shared_inits
+        shared_inits[#shared_inits + 1] = "NIL"
+        direct_shared_inits[#direct_shared_inits + 1] = "NIL"
+      end
+    end
+  end
+  if proto.C > 0 then
+    decls[#decls + 1] = ("value_t C[%d]"):format(proto.C)
+  end
+  if #shared_inits > 0 then
+    decls[#decls + 1] = "registers_t H"
+    inits[#inits + 1] = ("H { %s }"):format(table.concat(shared_inits, ", "))
+    direct_inits[#direct_inits + 1] = ("H { %s }"):format(table.concat(direct_shared_inits, ", "))
+    shared_vars = shared
+  end
+  decls[#decls + 1] = "array_t T"
+
+  local param = "const array_t& args"
+  if n == 0 and not proto.vararg then
+    param = "const array_t&"
   end
 
   out:write(([[
-  }
-]]):format(uid))
-end
 
-local function compile_basic_blocks(self, out, proto, opts)
-  local basic_blocks = proto.basic_blocks
-  local g = basic_blocks.g
-  local u = g.u
-  local u_after = u.after
-  local exit_uid = basic_blocks.exit_uid
-  local blocks = basic_blocks.blocks
+struct %s_program {
+  %s;
 
-  out:write(([[
+  %s_program(uparray_t U, %s)
+    : %s {}
+]]):format(
+    name,
+    template.concat(decls, ";\n  "),
+    name,
+    param,
+    template.concat(inits, ",\n      ")))
 
-  array_t entry() {
-    return BB%d();
-  }
-]]):format(basic_blocks.entry_uid))
+  if proto.direct then
+    out:write(([[
 
-  local uid = u.first
-  while uid do
-    if uid ~= exit_uid then
-      compile_basic_block(self, out, basic_blocks, uid, blocks[uid], "    ", opts)
-    end
-    uid = u_after[uid]
+  %s_program(%s)
+    : %s {}
+]]):format(
+      name,
+      table.concat(params, ", "),
+      template.concat(direct_inits, ",\n      ")))
   end
 
-  out:write(([[
+  compile_codes(self, out, proto, opts)
 
-  array_t BB%d(array_t V = {}) {
-    return V;
-  }
-]]):format(exit_uid))
+  out:write [[
+};
+]]
+
+  shared_vars = nil
+  literals = nil
 end
 
-local function compile_program(self, out, proto, opts)
+-- the protos are declared first, since the direct calls may refer to the
+-- protos compiled later.
+local function declare_proto(self, out, proto)
   local name = proto[1]
 
   out:write(([[
 
-struct %s_program {
-  const %s_constants* K;
-  uparray_t U;
-  array_t A;
-  array_t V;
-  array_t B;
-  array_t C;
-  array_t T;
-
-  %s_program(uparray_t U, array_t A, array_t V)
-    : K(%s_constants::get()),
-      U(U),
-      A(A),
-      V(V),
-      B(%d),
-      C(%d) {}
-]]):format(name, name, name, name, proto.B, proto.C))
+struct %s : proto_t {
+  explicit %s(uparray_t U)
+    : proto_t(U) {}
 
-  if opts.mode == "basic_blocks" then
-    compile_basic_blocks(self, out, proto, opts)
-  else
-    compile_codes(self, out, proto, opts)
+  array_t operator()(const array_t& args);
+]]):format(name, name))
+
+  if proto.direct then
+    local params = {}
+    for i = 1, proto.A do
+      params[i] = "value_t"
+    end
+    out:write(("  array_t invoke(%s);\n"):format(table.concat(params, ", ")))
   end
 
-  out:write [[
-};
-]]
+  out:write "};\n"
 end
 
 local function compile_proto(self, out, proto, opts)
   local name = proto[1]
-  local upvalues = proto.upvalues
-  local n = #upvalues
-
-  local inits = {}
-  for i = 1, n do
-    local var = upvalues[i][2]
-    local key = var:sub(1, 1)
-    if key == "U" then
-      inits[i] = ("S[%d]"):format(var:sub(2))
-    else
-      inits[i] = ("{ %s, %d }"):format(key, var:sub(2))
-    end
-  end
 
   compile_constants(self, out, proto, opts)
   compile_program(self, out, proto, opts)
 
   out:write(([[
 
-struct %s : proto_t<%d> {
-  uparray_t U;
-
-  %s(uparray_t S, array_t A, array_t B)
-    : U {%s} {}
+array_t %s::operator()(const array_t& args) {
+  %s_program program(U, args);
+  return program.entry();
+}
+]]):format(name, name))
+
+  if proto.direct then
+    local params = {}
+    local args = { "U" }
+    for i = 1, proto.A do
+      params[i] = ("value_t a%d"):format(i - 1)
+      args[i + 1] = ("std::move(a%d)"):format(i - 1)
+    end
+    out:write(([[
 
-  array_t operator()(array_t A, array_t V) const {
-    return std::make_shared<%s_program>(U, A, V)->entry();
-  }
-};
-]]):format(
-    name,
-    proto.A,
-    name,
-    template.concat(inits, ",\n        ", "\n        ", ",\n      "),
-    name))
+inline array_t %s::invoke(%s) {
+  %s_program program(%s);
+  return program.entry();
+}
+]]):format(name, table.concat(params, ", "), name, table.concat(args, ", ")))
+  end
 end
 
 return function (self, out, opts)
@@ -423,6 +966,9 @@ using namespace dromozoa::runtime;
 ]]):format(namespace))
 
   local protos = self.protos
+  for i = #protos, 1, -1 do
+    declare_proto(self, out, protos[i])
+  end
   for i = #protos, 1, -1 do
     compile_proto(self, out, protos[i], opts)
   end
@@ -430,11 +976,15 @@ using namespace dromozoa::runtime;
   out:write [[
 
 value_t chunk() {
-  uparray_t S;
-  array_t A;
-  array_t B = { env };
-  return std::make_shared<P0>(S, A, B);
+]]
+
+  out:write(([[
+  registers_t B = { env };
+  return make_ptr<P0>(%s);
 }
+]]):format(encode_upvalues(protos[1])))
+
+  out:write [[
 
 }
 ]]
@@ -446,6 +996,7 @@ int main(int, char*[]) {
   using namespace dromozoa::runtime;
   try {
     call0(chunk(), {});
+    collect();
     return 0;
   } catch (const value_t& e) {
     std::cerr << tostring(e) << std::endl;
@@ -97,7 +97,6 @@ local tmpl = template(encode_var, {
   BNOT     = "%1 = ~checkinteger(%2)";
   NOT      = "%1 = !toboolean(%2)";
   LEN      = "%1 = len(%2)";
-  CONCAT   = "%1 = concat(checkstring(%2), checkstring(%3))";
   EQ       = "%1 = eq(%2, %3)";
   NE       = "%1 = !eq(%2, %3)";
   LT       = "%1 = lt(%2, %3)";
@@ -162,6 +161,12 @@ function compile_code(self, out, code, indent, opts)
       else
         out:write(indent, ("return [ %s ];\n"):format(encode_vars(code)))
       end
+    elseif name == "CONCAT" then
+      local operands = {}
+      for i = 2, #code do
+        operands[#operands + 1] = ("checkstring(%s)"):format(encode_var(code[i]))
+      end
+      out:write(indent, ("%s = concat(%s);\n"):format(encode_var(code[1]), table.concat(operands, ", ")))
     elseif name == "SETLIST" then
       out:write(indent, ("setlist(%s, %d, %s);\n"):format(encode_var(code[1]), code[2], encode_var(code[3])))
     elseif name == "CLOSURE" then
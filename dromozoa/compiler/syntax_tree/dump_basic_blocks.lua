@@ -130,8 +130,7 @@ local function block_to_code(basic_blocks, uid, block)
   return html
 end
 
-local function to_code(proto)
-  local basic_blocks = proto.basic_blocks
+local function to_code(proto, basic_blocks, title)
   local g = basic_blocks.g
   local u = g.u
   local u_after = u.after
@@ -139,7 +138,7 @@ local function to_code(proto)
 
   local html = _"div" {
     class = "code";
-    _"span" { proto[1], " {\n" };
+    _"span" { proto[1], title, " {\n" };
   }
 
   local uid = u.first
@@ -215,12 +214,20 @@ local function to_graph(proto, width, height)
 end
 
 return function (proto, out)
+  local basic_blocks = proto.basic_blocks
+  local body = _"body" {}
+  -- the basic blocks before the optimization passes, if any.
+  local original = basic_blocks.original
+  if original then
+    body[#body + 1] = to_code(proto, original, " (before)")
+    body[#body + 1] = to_code(proto, basic_blocks, " (after)")
+  else
+    body[#body + 1] = to_code(proto, basic_blocks, "")
+  end
+  body[#body + 1] = to_graph(proto, 800, 640)
   local doc = html5_document(_"html" {
     head;
-    _"body" {
-      to_code(proto);
-      to_graph(proto, 800, 640);
-    };
+    body;
   })
   doc:serialize(out)
   out:write "\n"
@@ -37,8 +37,12 @@ local function dump_code(out, code, indent)
     out:write(indent, "}\n")
   else
     out:write(indent, code[0])
+    local unboxed = code.unboxed
     for i = 1, #code do
       out:write(" ", code[i])
+      if unboxed and unboxed[i] then
+        out:write(":", unboxed[i])
+      end
     end
     out:write "\n"
   end
@@ -63,6 +67,15 @@ local function dump_proto(out, proto, opts)
   out:write(("  A %d\n"):format(proto.A))
   out:write(("  B %d\n"):format(proto.B))
   out:write(("  C %d\n"):format(proto.C))
+  if proto.I > 0 then
+    out:write(("  I %d\n"):format(proto.I))
+  end
+  if proto.N > 0 then
+    out:write(("  N %d\n"):format(proto.N))
+  end
+  if proto.F > 0 then
+    out:write(("  F %d\n"):format(proto.F))
+  end
   if proto.V then
     out:write "  V\n"
   end
@@ -16,10 +16,28 @@
 -- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
 
 local graph = require "dromozoa.graph"
+local allocate_registers = require "dromozoa.compiler.syntax_tree.allocate_registers"
 local code_builder = require "dromozoa.compiler.syntax_tree.code_builder"
+local infer_types = require "dromozoa.compiler.syntax_tree.infer_types"
+local optimize = require "dromozoa.compiler.syntax_tree.optimize"
 
 local unpack = table.unpack or unpack
 
+-- the codes at the head of the loop of a numeric for, which advance the index
+-- and test it against the limit, are marked for compile_cxx.
+local function mark_fornum(stack, n, i)
+  local loop = stack[#stack]
+  local head = {}
+  for j = 1, n do
+    head[loop[j]] = true
+  end
+  local lt = loop[i]
+  if lt.block then
+    lt = lt[2][1]
+  end
+  loop.fornum = { add = loop[1], lt = lt, head = head }
+end
+
 local function generate_tree_code(stack, node, symbol_table)
   local proto = node.proto
   if proto then
@@ -60,6 +78,7 @@ local function generate_tree_code(stack, node, symbol_table)
            :    BREAK()
            :  COND_END()
            :  MOVE(node[3].var, vars[1])
+          mark_fornum(stack, 3, 2)
         elseif n == 5 then -- numerical for with step
           local vars = node.vars
           _:TONUMBER(vars[1], node[1].var)
@@ -83,6 +102,7 @@ local function generate_tree_code(stack, node, symbol_table)
            :    COND_END()
            :  COND_END()
            :  MOVE(node[4].var, vars[1])
+          mark_fornum(stack, 5, 3)
         else -- generic for
           local rvars = node[1].vars
           local lvars = node.vars
@@ -182,6 +202,18 @@ local function generate_tree_code(stack, node, symbol_table)
   elseif binop == "AND" or binop == "OR" then
     _:MOVE(node.var, node[2].var)
      :COND_END()
+  elseif binop == "CONCAT" then
+    -- the right operand of a chain is the code just written, which is merged
+    -- into one code with all the operands.
+    local that = node[2]
+    local block = stack[#stack]
+    local code = block[#block]
+    if that.binop == "CONCAT" and code and code[0] == "CONCAT" and code[1] == that.var then
+      block[#block] = nil
+      _:CONCAT(node.var, node[1].var, unpack(code, 2))
+    else
+      _:CONCAT(node.var, node[1].var, that.var)
+    end
   elseif binop then
     _[binop](_, node.var, node[1].var, node[2].var)
   elseif unop then
@@ -238,7 +270,7 @@ local function generate_flat_code(proto, flat_code, code, break_label)
         local x = "M" .. n
         local y = "M" .. n + 1
         proto.M = n + 2
-        flat_code[#flat_code + 1] = { [0] = "COND", cond[1], cond[2], x, y }
+        flat_code[#flat_code + 1] = { [0] = "COND", cond[1], cond[2], x, y, cond = cond }
         flat_code[#flat_code + 1] = { [0] = "LABEL", x }
         generate_flat_code(proto, flat_code, code[2], break_label)
         flat_code[#flat_code + 1] = { [0] = "LABEL", y }
@@ -248,7 +280,7 @@ local function generate_flat_code(proto, flat_code, code, break_label)
         local y = "M" .. n + 1
         local z = "M" .. n + 2
         proto.M = n + 3
-        flat_code[#flat_code + 1] = { [0] = "COND", cond[1], cond[2], x, y }
+        flat_code[#flat_code + 1] = { [0] = "COND", cond[1], cond[2], x, y, cond = cond }
         flat_code[#flat_code + 1] = { [0] = "LABEL", x }
         generate_flat_code(proto, flat_code, code[2], break_label)
         flat_code[#flat_code + 1] = { [0] = "GOTO", z }
@@ -347,7 +379,93 @@ local function generate_basic_blocks(proto)
   }
 end
 
-return function (self)
+-- the registers that closures capture.
+local function generate_captured(protos)
+  for i = 1, #protos do
+    protos[i].captured = {}
+  end
+  for i = 2, #protos do
+    local proto = protos[i]
+    local upvalues = proto.upvalues
+    for j = 1, #upvalues do
+      local var = upvalues[j][2]
+      if var:sub(1, 1) ~= "U" then
+        proto.parent.captured[var] = true
+      end
+    end
+  end
+end
+
+-- the calls to the local functions that are never assigned again are
+-- resolved to their protos, so that compile_cxx can call them directly.
+local function generate_callees(protos)
+  local protos_by_name = {}
+  for i = 1, #protos do
+    local proto = protos[i]
+    protos_by_name[proto[1]] = proto
+  end
+
+  -- the names written once, by a move from the closure made just before.
+  local functions = {}
+  for i = 1, #protos do
+    local proto = protos[i]
+    local blocks = proto.basic_blocks.blocks
+    local writes = {}
+    local closures = {}
+    for _, block in pairs(blocks) do
+      for j = 1, #block do
+        local code = block[j]
+        local name = code[0]
+        if name ~= "SETTABLE" and name ~= "SETLIST" and name ~= "RETURN" and name ~= "COND" then
+          local var = code[1]
+          writes[var] = (writes[var] or 0) + 1
+          local prev = block[j - 1]
+          if name == "MOVE" and prev and prev[0] == "CLOSURE" and prev[1] == code[2] then
+            closures[var] = prev[2]
+          end
+        end
+      end
+    end
+    local names = proto.names
+    for j = 1, #names do
+      local name = names[j]
+      local var = name[1]
+      if #name.def == 1 and #name.updef == 0 and writes[var] == 1 and closures[var] then
+        functions[name] = protos_by_name[closures[var]]
+      end
+    end
+  end
+
+  for i = 1, #protos do
+    local proto = protos[i]
+    local callees = {}
+    local names = proto.names
+    for j = 1, #names do
+      local name = names[j]
+      callees[name[1]] = functions[name]
+    end
+    local upvalues = proto.upvalues
+    for j = 1, #upvalues do
+      local upvalue = upvalues[j]
+      callees[upvalue[1]] = functions[upvalue.name]
+    end
+    for _, block in pairs(proto.basic_blocks.blocks) do
+      for j = 1, #block do
+        local code = block[j]
+        if code[0] == "CALL" then
+          local callee = callees[code[2]]
+          local last = code[#code]
+          if callee and not callee.vararg and last ~= "V" and last ~= "T" then
+            code.callee = callee[1]
+            callee.direct = true
+          end
+        end
+      end
+    end
+  end
+end
+
+return function (self, opts)
   generate_tree_code({ { block = true } }, self.accepted_node, self.symbol_table)
 
   local protos = self.protos
@@ -364,5 +482,11 @@ return function (self)
     generate_basic_blocks(protos[i])
   end
 
+  generate_captured(protos)
+  generate_callees(protos)
+  optimize(self, opts)
+  infer_types(self)
+  allocate_registers(self)
+
   return self
 end
@@ -0,0 +1,390 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local number_type = require "dromozoa.compiler.syntax_tree.number_type"
+local operands = require "dromozoa.compiler.syntax_tree.operands"
+
+-- the types of the values that the instructions write to %1. the others write
+-- any value, except the instructions in operand_types.
+local result_types = {
+  POW      = "float";
+  DIV      = "float";
+  BAND     = "integer";
+  BOR      = "integer";
+  BXOR     = "integer";
+  SHL      = "integer";
+  SHR      = "integer";
+  BNOT     = "integer";
+  LEN      = "integer";
+  NOT      = "boolean";
+  EQ       = "boolean";
+  NE       = "boolean";
+  LT       = "boolean";
+  LE       = "boolean";
+}
+
+local function arith_type(x, y)
+  if x == "integer" and y == "integer" then
+    return "integer"
+  elseif (x == "integer" or x == "float") and (y == "integer" or y == "float") then
+    return "float"
+  elseif x == nil or y == nil then
+    return nil
+  else
+    return "any"
+  end
+end
+
+local function unary_type(x)
+  if x == "integer" or x == "float" or x == nil then
+    return x
+  else
+    return "any"
+  end
+end
+
+-- the types of the values that the instructions write to %1, computed from the
+-- types of %2 and %3. nil means that the types are not known yet.
+local operand_types = {
+  ADD      = arith_type;
+  SUB      = arith_type;
+  MUL      = arith_type;
+  MOD      = arith_type;
+  IDIV     = arith_type;
+  UNM      = unary_type;
+  TONUMBER = unary_type;
+  MOVE     = function (x) return x end;
+}
+
+local unboxed_keys = {
+  integer = "I";
+  float = "N";
+  boolean = "F";
+}
+
+local function join(a, b)
+  if a == nil then
+    return b
+  elseif b == nil or a == b then
+    return a
+  else
+    return "any"
+  end
+end
+
+local function find(parents, id)
+  local parent = parents[id]
+  if parent == id then
+    return id
+  end
+  parent = find(parents, parent)
+  parents[id] = parent
+  return parent
+end
+
+local function infer_types(proto)
+  local constant_types = {}
+  local constants = proto.constants
+  for i = 1, #constants do
+    local constant = constants[i]
+    if constant.type == "string" then
+      constant_types[constant[1]] = "any"
+    else
+      constant_types[constant[1]] = number_type(constant.source)
+    end
+  end
+
+  local is_register, defines, first_use = operands(proto)
+
+  local basic_blocks = proto.basic_blocks
+  local g = basic_blocks.g
+  local u_after = g.u.after
+  local uv = g.uv
+  local uv_first = uv.first
+  local uv_after = uv.after
+  local uv_target = uv.target
+  local blocks = basic_blocks.blocks
+  local entry_uid = basic_blocks.entry_uid
+
+  -- reaching definitions. the parameters and the registers are defined at
+  -- the entry as any and nil respectively.
+  local defs = {}
+  local def_ids = {}
+  local entry = {}
+  local gens = {}
+  local uid = g.u.first
+  while uid do
+    local block = blocks[uid]
+    local gen = {}
+    for i = 1, #block do
+      local code = block[i]
+      for j = 1, #code do
+        local var = code[j]
+        if is_register(var) and not entry[var] then
+          local id = #defs + 1
+          if var:find "^A" then
+            defs[id] = { var = var, type = "any" }
+          else
+            defs[id] = { var = var, type = "nil" }
+          end
+          entry[var] = { [id] = true }
+        end
+      end
+      if defines(code) then
+        local id = #defs + 1
+        defs[id] = { var = code[1], code = code }
+        def_ids[code] = id
+        gen[code[1]] = { [id] = true }
+      end
+    end
+    gens[uid] = gen
+    uid = u_after[uid]
+  end
+
+  local ins = { [entry_uid] = entry }
+  local changed = true
+  while changed do
+    changed = false
+    local uid = g.u.first
+    while uid do
+      local out = {}
+      local gen = gens[uid]
+      local data = ins[uid]
+      if data then
+        for var, set in pairs(data) do
+          if not gen[var] then
+            out[var] = set
+          end
+        end
+      end
+      for var, set in pairs(gen) do
+        out[var] = set
+      end
+
+      local eid = uv_first[uid]
+      while eid do
+        local vid = uv_target[eid]
+        local data = ins[vid]
+        if not data then
+          data = {}
+          ins[vid] = data
+        end
+        for var, set in pairs(out) do
+          local target = data[var]
+          if not target then
+            target = {}
+            data[var] = target
+          end
+          for id in pairs(set) do
+            if not target[id] then
+              target[id] = true
+              changed = true
+            end
+          end
+        end
+        eid = uv_after[eid]
+      end
+      uid = u_after[uid]
+    end
+  end
+
+  -- the uses and the definitions that reach them.
+  local uses = {}
+  local uid = g.u.first
+  while uid do
+    local block = blocks[uid]
+    local data = {}
+    if ins[uid] then
+      for var, set in pairs(ins[uid]) do
+        data[var] = set
+      end
+    end
+    for i = 1, #block do
+      local code = block[i]
+      for j = first_use(code), #code do
+        local var = code[j]
+        if is_register(var) then
+          uses[#uses + 1] = { code = code, index = j, set = data[var] or {} }
+        elseif type(var) == "string" then
+          uses[#uses + 1] = { code = code, index = j }
+        end
+      end
+      if defines(code) then
+        data[code[1]] = { [def_ids[code]] = true }
+      end
+    end
+    uid = u_after[uid]
+  end
+
+  local function use_type(use)
+    local set = use.set
+    if set then
+      local result
+      for id in pairs(set) do
+        result = join(result, defs[id].type)
+      end
+      return result
+    end
+    local var = use.code[use.index]
+    if var == "NIL" then
+      return "nil"
+    elseif var == "TRUE" or var == "FALSE" then
+      return "boolean"
+    else
+      return constant_types[var] or "any"
+    end
+  end
+
+  -- the types of the definitions. the types of the operands are propagated
+  -- until nothing changes.
+  local operands = {}
+  for i = 1, #uses do
+    local use = uses[i]
+    local code = use.code
+    if operand_types[code[0]] and defines(code) then
+      local data = operands[code]
+      if not data then
+        data = {}
+        operands[code] = data
+      end
+      data[use.index] = use
+    end
+  end
+  for i = 1, #defs do
+    local def = defs[i]
+    local code = def.code
+    if code and not operand_types[code[0]] then
+      def.type = result_types[code[0]] or "any"
+    end
+  end
+  local changed = true
+  while changed do
+    changed = false
+    for i = 1, #defs do
+      local def = defs[i]
+      local code = def.code
+      local data = code and operands[code]
+      if data then
+        local x = data[2] and use_type(data[2])
+        local y = data[3] and use_type(data[3])
+        if code[3] == nil then
+          y = x
+        end
+        local t = join(def.type, operand_types[code[0]](x, y))
+        if def.type ~= t then
+          def.type = t
+          changed = true
+        end
+      end
+    end
+  end
+
+  -- the definitions that reach a same use share a register, so they are
+  -- merged into a web. the webs of integers, floats and booleans are unboxed.
+  local parents = {}
+  for i = 1, #defs do
+    parents[i] = i
+  end
+  for i = 1, #uses do
+    local set = uses[i].set
+    if set then
+      local x
+      for id in pairs(set) do
+        if x then
+          local y = find(parents, id)
+          if x ~= y then
+            parents[y] = x
+          end
+        else
+          x = find(parents, id)
+        end
+      end
+    end
+  end
+
+  local web_types = {}
+  for i = 1, #defs do
+    local x = find(parents, i)
+    web_types[x] = join(web_types[x], defs[i].type)
+  end
+
+  local counts = { I = 0, N = 0, F = 0 }
+  local names = {}
+  for i = 1, #defs do
+    local x = find(parents, i)
+    local key = unboxed_keys[web_types[x]]
+    if key and not names[x] then
+      local n = counts[key]
+      names[x] = key .. n
+      counts[key] = n + 1
+    end
+  end
+  proto.I = counts.I
+  proto.N = counts.N
+  proto.F = counts.F
+
+  local function annotate(code, key, index, value)
+    local t = code[key]
+    if not t then
+      t = {}
+      code[key] = t
+      local cond = code.cond
+      if cond then
+        cond[key] = t
+      end
+    end
+    t[index] = value
+  end
+
+  for i = 1, #defs do
+    local def = defs[i]
+    local code = def.code
+    if code then
+      local name = names[find(parents, i)]
+      if name then
+        annotate(code, "unboxed", 1, name)
+      end
+    end
+  end
+
+  for i = 1, #uses do
+    local use = uses[i]
+    local code = use.code
+    local index = use.index
+    local set = use.set
+    if set then
+      local id = next(set)
+      if id then
+        local name = names[find(parents, id)]
+        if name then
+          annotate(code, "unboxed", index, name)
+        end
+      end
+    end
+    local t = use_type(use)
+    if unboxed_keys[t] then
+      annotate(code, "types", index, t)
+    end
+  end
+end
+
+return function (self)
+  local protos = self.protos
+  for i = 1, #protos do
+    infer_types(protos[i])
+  end
+end
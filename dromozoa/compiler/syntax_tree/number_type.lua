@@ -0,0 +1,42 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local math_type = math.type
+
+-- the subtype of a numeric constant, "integer" or "float", as Lua 5.3 reads
+-- its source. the hosts before Lua 5.3 have no math.type, so the source is
+-- classified by its form: a hexadecimal without a point or an exponent is
+-- an integer, and so is a decimal without them that fits in 64 bits.
+return function (source)
+  if math_type then
+    return math_type(tonumber(source))
+  end
+  if source:find "^0[xX]" then
+    if source:find "[%.pP]" then
+      return "float"
+    end
+    return "integer"
+  end
+  if source:find "[%.eE]" then
+    return "float"
+  end
+  local digits = source:gsub("^0*", "")
+  if #digits < 19 or #digits == 19 and digits <= "9223372036854775807" then
+    return "integer"
+  end
+  return "float"
+end
@@ -0,0 +1,52 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+-- the instructions that only read their operands.
+local no_def = {
+  SETTABLE = true;
+  SETLIST  = true;
+  RETURN   = true;
+  COND     = true;
+}
+
+-- the operands of the codes of the proto, as infer_types, optimize and
+-- allocate_registers see them. returns is_register, defines and first_use.
+return function (proto)
+  local captured = proto.captured
+
+  -- the parameters, the locals and the temporaries. the captured registers
+  -- are not tracked since the closures may write them at any call.
+  local function is_register(var)
+    return type(var) == "string" and var:find "^[ABC]%d+$" and not captured[var]
+  end
+
+  -- whether the code writes the register %1.
+  local function defines(code)
+    return not no_def[code[0]] and is_register(code[1])
+  end
+
+  -- the index of the first operand that the code reads.
+  local function first_use(code)
+    if no_def[code[0]] then
+      return 1
+    else
+      return 2
+    end
+  end
+
+  return is_register, defines, first_use
+end
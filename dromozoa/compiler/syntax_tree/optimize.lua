@@ -0,0 +1,576 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local graph = require "dromozoa.graph"
+local operands = require "dromozoa.compiler.syntax_tree.operands"
+
+-- the passes rewrite the codes in place, so the rewrites are seen by
+-- tree_code and flat_code too. only the basic blocks are restructured.
+
+-- the instructions that do nothing but write %1.
+local pure = {
+  MOVE     = true;
+  NOT      = true;
+  NEWTABLE = true;
+  CLOSURE  = true;
+}
+
+local math_type = math.type
+
+-- the operations on numbers, which are folded as the host Lua 5.3 does. the
+-- hosts before Lua 5.3 have no integers, so the numbers are not folded there.
+local arith = {
+  ADD  = function (x, y) return x + y end;
+  SUB  = function (x, y) return x - y end;
+  MUL  = function (x, y) return x * y end;
+  MOD  = function (x, y) return x % y end;
+  POW  = function (x, y) return x ^ y end;
+  DIV  = function (x, y) return x / y end;
+  UNM  = function (x) return -x end;
+  LT   = function (x, y) return x < y end;
+  LE   = function (x, y) return x <= y end;
+}
+
+-- the integer operators do not parse before Lua 5.3.
+if math_type then
+  local integer_arith = assert(load [[
+    return {
+      IDIV = function (x, y) return x // y end;
+      BAND = function (x, y) return x & y end;
+      BOR  = function (x, y) return x | y end;
+      BXOR = function (x, y) return x ~ y end;
+      SHL  = function (x, y) return x << y end;
+      SHR  = function (x, y) return x >> y end;
+      BNOT = function (x) return ~x end;
+    }
+  ]])()
+  for name, f in pairs(integer_arith) do
+    arith[name] = f
+  end
+end
+
+local names = {
+  "fold_constants";
+  "propagate_copies";
+  "eliminate_dead_code";
+  "fold_branches";
+  "prune_unreachable_blocks";
+}
+
+local function each_code(basic_blocks, f)
+  local blocks = basic_blocks.blocks
+  local u_after = basic_blocks.g.u.after
+  local uid = basic_blocks.g.u.first
+  while uid do
+    local block = blocks[uid]
+    for i = 1, #block do
+      f(block[i], uid, block, i)
+    end
+    uid = u_after[uid]
+  end
+end
+
+local function set_operand(code, i, var)
+  code[i] = var
+  local cond = code.cond
+  if cond then
+    cond[i] = var
+  end
+end
+
+-- the basic blocks before the passes, for dump_basic_blocks. the vertices
+-- are numbered from 1 by generate, so the copy has the same uids.
+local function copy_basic_blocks(basic_blocks)
+  local g = basic_blocks.g
+  local u = g.u
+  local uv = g.uv
+  local h = graph()
+  local blocks = {}
+  local jumps = {}
+  local uid = u.first
+  while uid do
+    h:add_vertex()
+    local block = basic_blocks.blocks[uid]
+    local copy = { label = block.label, ["goto"] = block["goto"] }
+    for i = 1, #block do
+      local code = block[i]
+      local that = { [0] = code[0] }
+      for j = 1, #code do
+        that[j] = code[j]
+      end
+      copy[i] = that
+    end
+    blocks[uid] = copy
+    uid = u.after[uid]
+  end
+  uid = u.first
+  while uid do
+    local eid = uv.first[uid]
+    while eid do
+      jumps[h:add_edge(uid, uv.target[eid])] = basic_blocks.jumps[eid]
+      eid = uv.after[eid]
+    end
+    uid = u.after[uid]
+  end
+  return {
+    g = h;
+    entry_uid = basic_blocks.entry_uid;
+    exit_uid = basic_blocks.exit_uid;
+    blocks = blocks;
+    jumps = jumps;
+  }
+end
+
+local function optimize(proto, selected)
+  local constants = proto.constants
+  local basic_blocks = proto.basic_blocks
+  local g = basic_blocks.g
+  local blocks = basic_blocks.blocks
+  local removed = {}
+
+  local is_register, defines, first_use = operands(proto)
+
+  local function is_constant(var)
+    return var == "NIL" or var == "TRUE" or var == "FALSE" or type(var) == "string" and var:find "^K%d+$"
+  end
+
+  local function to_value(var)
+    if var == "TRUE" then
+      return true
+    elseif var == "FALSE" then
+      return false
+    elseif var == "NIL" then
+      return nil
+    end
+    local constant = constants[var:sub(2) + 1]
+    if constant.type == "string" then
+      return constant.source
+    else
+      return tonumber(constant.source)
+    end
+  end
+
+  local function to_var(v)
+    if v == true then
+      return "TRUE"
+    elseif v == false then
+      return "FALSE"
+    end
+    local t = math_type(v)
+    if not t or v ~= v or v == math.huge or v == -math.huge then
+      return
+    end
+    local source
+    if t == "integer" then
+      source = ("%d"):format(v)
+    else
+      if v == 0 then
+        return
+      end
+      source = ("%.17g"):format(v)
+      if source:find "^%-?%d+$" then
+        source = source .. ".0"
+      end
+    end
+    local n = #constants
+    for i = 1, n do
+      local constant = constants[i]
+      if constant.type == t and constant.source == source then
+        return constant[1]
+      end
+    end
+    constants[n + 1] = {
+      type = t;
+      source = source;
+      use = {};
+      "K" .. n;
+    }
+    return "K" .. n
+  end
+
+  local function is_number(var)
+    if type(var) == "string" and var:find "^K%d+$" then
+      return constants[var:sub(2) + 1].type ~= "string"
+    end
+  end
+
+  local function fold(code)
+    local name = code[0]
+    local x = code[2]
+    local y = code[3]
+    if name == "NOT" then
+      if is_constant(x) then
+        return "NOT", not to_value(x)
+      end
+    elseif name == "EQ" or name == "NE" then
+      if is_constant(x) and is_constant(y) and (math_type or not (is_number(x) and is_number(y))) then
+        return name, (name == "EQ") == (to_value(x) == to_value(y))
+      end
+    elseif name == "TONUMBER" then
+      if is_number(x) then
+        return name, x
+      end
+    else
+      local f = math_type and arith[name]
+      if f and is_number(x) and (y == nil or is_number(y)) then
+        local result, v = pcall(f, to_value(x), y and to_value(y))
+        if result then
+          return name, v
+        end
+      end
+    end
+  end
+
+  local passes = {}
+
+  -- replaces the operations on constants with MOVEs of their results.
+  function passes.fold_constants()
+    local changed = false
+    each_code(basic_blocks, function (code)
+      if defines(code) then
+        local name, v = fold(code)
+        if name then
+          local var = v
+          if name ~= "TONUMBER" then
+            var = to_var(v)
+          end
+          if var then
+            code[0] = "MOVE"
+            code[2] = var
+            code[3] = nil
+            changed = true
+          end
+        end
+      end
+    end)
+    return changed
+  end
+
+  -- replaces the uses of the destinations of MOVEs with their sources while
+  -- the copies are available on every path.
+  function passes.propagate_copies()
+    local u_after = g.u.after
+    local uv = g.uv
+    local uv_first = uv.first
+    local uv_after = uv.after
+    local uv_target = uv.target
+
+    local function transfer(code, copies)
+      if defines(code) then
+        local var = code[1]
+        copies[var] = nil
+        for k, v in pairs(copies) do
+          if v == var then
+            copies[k] = nil
+          end
+        end
+        if code[0] == "MOVE" then
+          local source = code[2]
+          if source ~= var and (is_register(source) or is_constant(source)) then
+            copies[var] = source
+          end
+        end
+      end
+    end
+
+    local ins = { [basic_blocks.entry_uid] = {} }
+    local changed = true
+    while changed do
+      changed = false
+      local uid = g.u.first
+      while uid do
+        local data = ins[uid]
+        if data then
+          local copies = {}
+          for k, v in pairs(data) do
+            copies[k] = v
+          end
+          local block = blocks[uid]
+          for i = 1, #block do
+            transfer(block[i], copies)
+          end
+          local eid = uv_first[uid]
+          while eid do
+            local vid = uv_target[eid]
+            local target = ins[vid]
+            if not target then
+              target = {}
+              for k, v in pairs(copies) do
+                target[k] = v
+              end
+              ins[vid] = target
+              changed = true
+            else
+              for k, v in pairs(target) do
+                if copies[k] ~= v then
+                  target[k] = nil
+                  changed = true
+                end
+              end
+            end
+            eid = uv_after[eid]
+          end
+        end
+        uid = u_after[uid]
+      end
+    end
+
+    local result = false
+    local uid = g.u.first
+    while uid do
+      local data = ins[uid]
+      if data then
+        local copies = {}
+        for k, v in pairs(data) do
+          copies[k] = v
+        end
+        local block = blocks[uid]
+        for i = 1, #block do
+          local code = block[i]
+          for j = first_use(code), #code do
+            local source = copies[code[j]]
+            if source then
+              set_operand(code, j, source)
+              result = true
+            end
+          end
+          transfer(code, copies)
+        end
+      end
+      uid = u_after[uid]
+    end
+    return result
+  end
+
+  -- removes the pure instructions whose results are never used.
+  function passes.eliminate_dead_code()
+    local u_after = g.u.after
+    local uv = g.uv
+    local uv_first = uv.first
+    local uv_after = uv.after
+    local uv_target = uv.target
+
+    local function live_out(uid, ins)
+      local live = {}
+      local eid = uv_first[uid]
+      while eid do
+        local data = ins[uv_target[eid]]
+        if data then
+          for var in pairs(data) do
+            live[var] = true
+          end
+        end
+        eid = uv_after[eid]
+      end
+      return live
+    end
+
+    local function transfer(code, live)
+      if defines(code) then
+        live[code[1]] = nil
+      end
+      for j = first_use(code), #code do
+        local var = code[j]
+        if is_register(var) then
+          live[var] = true
+        end
+      end
+    end
+
+    local ins = {}
+    local changed = true
+    while changed do
+      changed = false
+      local uid = g.u.first
+      while uid do
+        local live = live_out(uid, ins)
+        local block = blocks[uid]
+        for i = #block, 1, -1 do
+          transfer(block[i], live)
+        end
+        local data = ins[uid]
+        if not data then
+          data = {}
+          ins[uid] = data
+        end
+        for var in pairs(live) do
+          if not data[var] then
+            data[var] = true
+            changed = true
+          end
+        end
+        uid = u_after[uid]
+      end
+    end
+
+    local result = false
+    local uid = g.u.first
+    while uid do
+      local live = live_out(uid, ins)
+      local block = blocks[uid]
+      for i = #block, 1, -1 do
+        local code = block[i]
+        local var = code[1]
+        if pure[code[0]] and defines(code) and (not live[var] or code[0] == "MOVE" and code[2] == var) then
+          table.remove(block, i)
+          removed[code] = true
+          result = true
+        else
+          transfer(code, live)
+        end
+      end
+      uid = u_after[uid]
+    end
+    return result
+  end
+
+  -- replaces the CONDs on constants with jumps to their targets.
+  function passes.fold_branches()
+    local uv = g.uv
+    local jumps = basic_blocks.jumps
+    local result = false
+    local uid = g.u.first
+    while uid do
+      local block = blocks[uid]
+      local code = block[#block]
+      if code and code[0] == "COND" and is_constant(code[1]) then
+        local then_eid = uv.first[uid]
+        local else_eid = uv.after[then_eid]
+        local eid = else_eid
+        if (to_value(code[1]) and "TRUE" or "FALSE") ~= code[2] then
+          eid = then_eid
+        end
+        g:remove_edge(eid)
+        jumps[then_eid] = nil
+        jumps[else_eid] = nil
+        block[#block] = nil
+        result = true
+      end
+      uid = g.u.after[uid]
+    end
+    return result
+  end
+
+  -- removes the blocks that are not reachable from the entry.
+  function passes.prune_unreachable_blocks()
+    local uv = g.uv
+    local vu = g.vu
+    local entry_uid = basic_blocks.entry_uid
+    local exit_uid = basic_blocks.exit_uid
+    local reached = { [entry_uid] = true, [exit_uid] = true }
+    local stack = { entry_uid }
+    while #stack > 0 do
+      local uid = stack[#stack]
+      stack[#stack] = nil
+      local eid = uv.first[uid]
+      while eid do
+        local vid = uv.target[eid]
+        if not reached[vid] then
+          reached[vid] = true
+          stack[#stack + 1] = vid
+        end
+        eid = uv.after[eid]
+      end
+    end
+
+    local result = false
+    local uid = g.u.first
+    while uid do
+      local next_uid = g.u.after[uid]
+      if not reached[uid] then
+        local eid = uv.first[uid]
+        while eid do
+          local next_eid = uv.after[eid]
+          basic_blocks.jumps[eid] = nil
+          g:remove_edge(eid)
+          eid = next_eid
+        end
+        eid = vu.first[uid]
+        while eid do
+          local next_eid = vu.after[eid]
+          g:remove_edge(eid)
+          eid = next_eid
+        end
+        local block = blocks[uid]
+        for i = 1, #block do
+          local code = block[i]
+          if code[0] ~= "COND" then
+            removed[code] = true
+          end
+        end
+        g:remove_vertex(uid)
+        blocks[uid] = nil
+        result = true
+      end
+      uid = next_uid
+    end
+    return result
+  end
+
+  basic_blocks.original = copy_basic_blocks(basic_blocks)
+
+  local changed = true
+  while changed do
+    changed = false
+    for i = 1, #names do
+      local name = names[i]
+      if selected[name] and passes[name]() then
+        changed = true
+      end
+    end
+  end
+
+  return removed
+end
+
+local function sweep(code, removed)
+  local n = 0
+  for i = 1, #code do
+    local that = code[i]
+    if that.block then
+      sweep(that, removed)
+    end
+    if not removed[that] then
+      n = n + 1
+      code[n] = that
+    end
+  end
+  for i = #code, n + 1, -1 do
+    code[i] = nil
+  end
+end
+
+return function (self, opts)
+  local selected = opts and opts.optimize
+  if not selected then
+    return
+  end
+  if selected == true then
+    selected = {}
+    for i = 1, #names do
+      selected[names[i]] = true
+    end
+  end
+
+  local protos = self.protos
+  for i = 1, #protos do
+    local proto = protos[i]
+    local removed = optimize(proto, selected)
+    sweep(proto.tree_code, removed)
+    sweep(proto.flat_code, removed)
+  end
+end
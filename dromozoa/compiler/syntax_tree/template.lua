@@ -37,7 +37,8 @@ function class:eval(name, code)
   local rule = self.rules[name]
   if rule then
     return rule:gsub("%%(%d)", function (index)
-      return encode(code[tonumber(index)])
+      index = tonumber(index)
+      return encode(code[index], code, index)
     end)
   end
 end
@@ -22,109 +22,187 @@
 
 #include "runtime.hpp"
 
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_map>
 #include <utility>
 
 namespace dromozoa {
   namespace runtime {
     namespace {
-      void copy_construct(value_t& self, const value_t& that) {
-        self.type = that.type;
-        switch (self.type) {
-          case type_t::nil:
-            break;
-          case type_t::boolean:
-            self.boolean = that.boolean;
-            break;
-          case type_t::number:
-            self.number = that.number;
-            break;
-          case type_t::string:
-            new (&self.string) string_ptr(that.string);
-            break;
-          case type_t::table:
-            new (&self.table) table_ptr(that.table);
-            break;
-          case type_t::function:
-            new (&self.function) function_ptr(that.function);
-            break;
-          default:
-            throw std::logic_error("unreachable code");
+      // FNV-1a
+      std::size_t hash_string(const char* data, std::size_t size) {
+        std::uint64_t hash = 0xCBF29CE484222325ULL;
+        for (std::size_t i = 0; i < size; ++i) {
+          hash ^= static_cast<std::uint8_t>(data[i]);
+          hash *= 0x100000001B3ULL;
         }
+        return hash;
       }
 
-      void move_construct(value_t& self, value_t&& that) {
-        self.type = that.type;
-        that.type = type_t::nil;
-        switch (self.type) {
-          case type_t::nil:
-            break;
-          case type_t::boolean:
-            self.boolean = that.boolean;
-            break;
-          case type_t::number:
-            self.number = that.number;
-            break;
-          case type_t::string:
-            new (&self.string) string_ptr(std::move(that.string));
-            break;
-          case type_t::table:
-            new (&self.table) table_ptr(std::move(that.table));
-            break;
-          case type_t::function:
-            new (&self.function) function_ptr(std::move(that.function));
-            break;
-          default:
-            throw std::logic_error("unreachable code");
+      using string_table_t = std::unordered_multimap<std::size_t, string_t*>;
+
+      // never destructed so that strings can be released at any time
+      string_table_t& string_table() {
+        static string_table_t* instance = new string_table_t();
+        return *instance;
+      }
+
+      string_ptr find_string(const char* data, std::size_t size, std::size_t hash) {
+        const auto range = string_table().equal_range(hash);
+        for (auto i = range.first; i != range.second; ++i) {
+          const auto* string = i->second;
+          if (string->size == size && std::memcmp(string->data, data, size) == 0) {
+            return string_ptr(i->second);
+          }
         }
+        return nullptr;
       }
 
-      void destruct(value_t& self) {
-        switch (self.type) {
-          case type_t::nil:
-            break;
-          case type_t::boolean:
-            break;
-          case type_t::number:
-            break;
-          case type_t::string:
-            self.string.~shared_ptr();
-            break;
-          case type_t::table:
-            self.table.~shared_ptr();
-            break;
-          case type_t::function:
-            self.function.~shared_ptr();
-            break;
-          default:
-            throw std::logic_error("unreachable code");
+      string_ptr insert_string(std::string&& data, std::size_t hash) {
+        auto string = make_ptr<string_t>(std::move(data), hash);
+        string->interned = true;
+        string_table().emplace(hash, string.get());
+        return string;
+      }
+
+      string_ptr make_string(const char* data, std::size_t size) {
+        const auto hash = hash_string(data, size);
+        if (size <= DROMOZOA_COMPILER_RUNTIME_SHORT_STRING_MAX) {
+          if (auto string = find_string(data, size, hash)) {
+            return string;
+          }
+          return insert_string(std::string(data, size), hash);
         }
+        return make_ptr<string_t>(std::string(data, size), hash);
       }
 
-      struct noop_t : function_t {
-        virtual array_t operator()(array_t) {
-          return {};
+      string_ptr make_string(std::string&& data) {
+        const auto hash = hash_string(data.data(), data.size());
+        if (data.size() <= DROMOZOA_COMPILER_RUNTIME_SHORT_STRING_MAX) {
+          if (auto string = find_string(data.data(), data.size(), hash)) {
+            return string;
+          }
+          return insert_string(std::move(data), hash);
         }
+        return make_ptr<string_t>(std::move(data), hash);
+      }
+
+      // the substring of a long string shares its buffer. a slice of a slice
+      // refers to the same buffer. the shapes find the short strings by
+      // identity, so a short substring is interned instead of being sliced.
+      string_ptr make_substring(const string_ptr& string, std::size_t begin, std::size_t size) {
+        if (size == string->size) {
+          return string;
+        } else if (size < DROMOZOA_COMPILER_RUNTIME_SLICE_MIN || size <= DROMOZOA_COMPILER_RUNTIME_SHORT_STRING_MAX) {
+          return make_string(string->data + begin, size);
+        } else if (string->parent) {
+          return make_ptr<string_t>(string->parent, string->data - string->parent->data + begin, size);
+        } else {
+          return make_ptr<string_t>(string, begin, size);
+        }
+      }
+
+      std::size_t string_hash(string_t& string) {
+        if (!string.hashed) {
+          string.hash = hash_string(string.data, string.size);
+          string.hashed = true;
+        }
+        return string.hash;
+      }
+
+      bool string_eq(const string_t& self, const string_t& that) {
+        return self.size == that.size && std::memcmp(self.data, that.data, self.size) == 0;
+      }
+
+      bool string_lt(const string_t& self, const string_t& that) {
+        const auto result = std::memcmp(self.data, that.data, std::min(self.size, that.size));
+        return result < 0 || (result == 0 && self.size < that.size);
+      }
+
+      enum struct event_t : std::uint8_t {
+        index,
+        newindex,
+        call,
+        tostring,
+        len,
+        eq,
+        lt,
+        le,
+        metatable,
       };
 
-      bool is_hexint(const std::string& s) {
-        auto i = s.find("0x");
-        if (i == std::string::npos) {
-          i = s.find("0X");
-          if (i == std::string::npos) {
-            return false;
+      const value_t event_keys[] = {
+        intern("__index", 7),
+        intern("__newindex", 10),
+        intern("__call", 6),
+        intern("__tostring", 10),
+        intern("__len", 5),
+        intern("__eq", 4),
+        intern("__lt", 4),
+        intern("__le", 4),
+        intern("__metatable", 11),
+      };
+
+      const value_t& metafield(const value_t& metatable, event_t event) {
+        if (metatable.is_table()) {
+          auto& table = *metatable.table;
+          const std::uint16_t mask = 1 << static_cast<int>(event);
+          if (table.flags & mask) {
+            return NIL;
           }
+          const auto& field = table.get(event_keys[static_cast<int>(event)]);
+          if (field.is_nil()) {
+            table.flags |= mask;
+          }
+          return field;
+        } else {
+          return NIL;
         }
-        if (i == s.find_first_not_of(" \f\r\n\t\v+-")) {
-          return s.find_first_not_of(" \f\r\n\t\v0123456789ABCDEFabcdef", i + 2) == std::string::npos;
+      }
+
+      const value_t& getmetafield(const value_t& object, event_t event) {
+        if (object.is_string()) {
+          return metafield(string_metatable, event);
+        } else if (object.is_table()) {
+          return metafield(object.table->metatable, event);
+        } else {
+          return NIL;
         }
-        return false;
       }
 
+      // the steps of the cycle collector. see collect.
+      struct subtract_t : visitor_t {
+        virtual void operator()(container_t* object) {
+          --object->refs;
+        }
+      };
+
+      struct mark_t : visitor_t {
+        virtual void operator()(container_t* object) {
+          if (!object->marked) {
+            object->marked = true;
+            stack.push_back(object);
+          }
+        }
+
+        std::vector<container_t*> stack;
+      };
+
+      struct noop_t : function_t {
+        virtual array_t operator()(const array_t&) {
+          return {};
+        }
+      };
+
       std::size_t range_i(std::int64_t i, std::size_t size) {
         if (i < 0) {
           i += size;
@@ -155,6 +233,638 @@ namespace dromozoa {
         }
       }
 
+      bool tointeger(double number, std::int64_t& result) {
+        if (number >= -9223372036854775808.0 && number < 9223372036854775808.0) {
+          const auto integer = static_cast<std::int64_t>(number);
+          if (integer == number) {
+            result = integer;
+            return true;
+          }
+        }
+        return false;
+      }
+
+      // -2^53 <= integer <= 2^53, so the integer is exact as a float.
+      bool is_exact_float(std::int64_t integer) {
+        return static_cast<std::uint64_t>(integer) + (1ULL << 53) <= (1ULL << 54);
+      }
+
+      // compares numbers exactly, as LTnum and LEnum of Lua do. an integer
+      // that is not exact as a float is compared with the float rounded to
+      // an integer; a float out of range of the integers is greater or less
+      // than any integer, and nan is neither.
+      bool lt_number(const value_t& self, const value_t& that) {
+        std::int64_t integer = 0;
+        if (self.is_integer()) {
+          if (that.is_integer()) {
+            return self.integer < that.integer;
+          } else if (is_exact_float(self.integer)) {
+            return static_cast<double>(self.integer) < that.number;
+          } else if (tointeger(std::ceil(that.number), integer)) {
+            return self.integer < integer;
+          }
+          return that.number > 0;
+        } else if (that.is_integer()) {
+          if (is_exact_float(that.integer)) {
+            return self.number < static_cast<double>(that.integer);
+          } else if (tointeger(std::floor(self.number), integer)) {
+            return integer < that.integer;
+          }
+          return self.number < 0;
+        }
+        return self.number < that.number;
+      }
+
+      bool le_number(const value_t& self, const value_t& that) {
+        std::int64_t integer = 0;
+        if (self.is_integer()) {
+          if (that.is_integer()) {
+            return self.integer <= that.integer;
+          } else if (is_exact_float(self.integer)) {
+            return static_cast<double>(self.integer) <= that.number;
+          } else if (tointeger(std::floor(that.number), integer)) {
+            return self.integer <= integer;
+          }
+          return that.number > 0;
+        } else if (that.is_integer()) {
+          if (is_exact_float(that.integer)) {
+            return self.number <= static_cast<double>(that.integer);
+          } else if (tointeger(std::ceil(self.number), integer)) {
+            return integer <= that.integer;
+          }
+          return self.number < 0;
+        }
+        return self.number <= that.number;
+      }
+
+      bool is_space(char c) {
+        return c == ' ' || ('\t' <= c && c <= '\r');
+      }
+
+      int decimal_digit(char c) {
+        if ('0' <= c && c <= '9') {
+          return c - '0';
+        }
+        return -1;
+      }
+
+      int hexadecimal_digit(char c) {
+        if ('0' <= c && c <= '9') {
+          return c - '0';
+        } else if ('A' <= c && c <= 'F') {
+          return c - 'A' + 10;
+        } else if ('a' <= c && c <= 'f') {
+          return c - 'a' + 10;
+        }
+        return -1;
+      }
+
+      // the powers of ten that are exact as doubles.
+      const double exact_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+      };
+
+      // adds the signed decimal exponent that ends the string.
+      bool str2exponent(const char* p, const char* end, int& exponent) {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+          negative = *p++ == '-';
+        }
+        if (p == end) {
+          return false;
+        }
+        int e = 0;
+        for (; p < end; ++p) {
+          const auto d = decimal_digit(*p);
+          if (d < 0) {
+            return false;
+          }
+          if (e < 100000) {
+            e = e * 10 + d;
+          }
+        }
+        exponent += negative ? -e : e;
+        return true;
+      }
+
+      // hexadecimal integers wrap around. hexadecimal floats are rounded as
+      // lua_strx2number does: 30 significant digits, then the exponent.
+      bool str2hexadecimal(const char* p, const char* end, bool negative, value_t& result) {
+        std::uint64_t integer = 0;
+        double mantissa = 0;
+        int exponent = 0;
+        int significant = 0;
+        bool digit = false;
+        bool point = false;
+        for (; p < end; ++p) {
+          if (*p == '.') {
+            if (point) {
+              return false;
+            }
+            point = true;
+            continue;
+          }
+          const auto d = hexadecimal_digit(*p);
+          if (d < 0) {
+            break;
+          }
+          digit = true;
+          integer = integer * 16 + d;
+          if (significant == 0 && d == 0) {
+            if (point) {
+              exponent -= 4;
+            }
+          } else if (++significant <= 30) {
+            mantissa = mantissa * 16 + d;
+            if (point) {
+              exponent -= 4;
+            }
+          } else if (!point) {
+            exponent += 4;
+          }
+        }
+        if (!digit) {
+          return false;
+        }
+        if (p == end && !point) {
+          result = static_cast<std::int64_t>(negative ? 0 - integer : integer);
+          return true;
+        }
+        if (p < end) {
+          if ((*p != 'p' && *p != 'P') || !str2exponent(p + 1, end, exponent)) {
+            return false;
+          }
+        }
+        const auto number = std::ldexp(mantissa, exponent);
+        result = negative ? -number : number;
+        return true;
+      }
+
+      // decimal integers that overflow are floats. floats with at most 15
+      // significant digits and small exponents are exact products or
+      // quotients of doubles; the others go to strtod.
+      bool str2decimal(const char* p, const char* end, bool negative, value_t& result) {
+        const char* const begin = p;
+        std::uint64_t integer = 0;
+        const std::uint64_t limit = negative ? 9223372036854775808ULL : 9223372036854775807ULL;
+        bool overflow = false;
+        std::uint64_t mantissa = 0;
+        int exponent = 0;
+        int significant = 0;
+        bool digit = false;
+        bool point = false;
+        for (; p < end; ++p) {
+          if (*p == '.') {
+            if (point) {
+              return false;
+            }
+            point = true;
+            continue;
+          }
+          const auto d = decimal_digit(*p);
+          if (d < 0) {
+            break;
+          }
+          digit = true;
+          if (!point) {
+            if (integer > (limit - d) / 10) {
+              overflow = true;
+            } else {
+              integer = integer * 10 + d;
+            }
+          }
+          if (significant == 0 && d == 0) {
+            if (point) {
+              --exponent;
+            }
+          } else if (++significant <= 19) {
+            mantissa = mantissa * 10 + d;
+            if (point) {
+              --exponent;
+            }
+          } else if (!point) {
+            ++exponent;
+          }
+        }
+        if (!digit) {
+          return false;
+        }
+        if (p == end && !point && !overflow) {
+          result = static_cast<std::int64_t>(negative ? 0 - integer : integer);
+          return true;
+        }
+        if (p < end) {
+          if ((*p != 'e' && *p != 'E') || !str2exponent(p + 1, end, exponent)) {
+            return false;
+          }
+        }
+        double number = 0;
+        if (significant <= 15 && -22 <= exponent && exponent <= 22) {
+          number = static_cast<double>(mantissa);
+          if (exponent < 0) {
+            number /= exact_pow10[-exponent];
+          } else {
+            number *= exact_pow10[exponent];
+          }
+        } else {
+          // strtod reads the decimal point of the C locale, which the
+          // runtime never changes.
+          const std::size_t size = end - begin;
+          char buffer[64];
+          if (size < sizeof(buffer)) {
+            std::memcpy(buffer, begin, size);
+            buffer[size] = '\0';
+            number = std::strtod(buffer, nullptr);
+          } else {
+            number = std::strtod(std::string(begin, end).c_str(), nullptr);
+          }
+        }
+        result = negative ? -number : number;
+        return true;
+      }
+
+      // converts a string to an integer or a float as the lexer does.
+      // leading and trailing spaces are skipped. inf and nan are not
+      // numbers.
+      bool str2number(const char* data, std::size_t size, value_t& result) {
+        const char* p = data;
+        const char* end = data + size;
+        while (p < end && is_space(*p)) {
+          ++p;
+        }
+        while (p < end && is_space(end[-1])) {
+          --end;
+        }
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+          negative = *p++ == '-';
+        }
+        if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+          return str2hexadecimal(p + 2, end, negative, result);
+        }
+        return str2decimal(p, end, negative, result);
+      }
+
+      // integers in decimal. floats as %.14g, with .0 appended when they
+      // look like integers, as Lua does.
+      // the buffer has number_size bytes. returns the length.
+      constexpr std::size_t number_size = 32;
+
+      std::size_t integer2buffer(std::int64_t integer, char* buffer) {
+        char digits[20];
+        std::size_t n = 0;
+        std::uint64_t u = integer < 0 ? 0 - static_cast<std::uint64_t>(integer) : integer;
+        do {
+          digits[n++] = '0' + u % 10;
+          u /= 10;
+        } while (u > 0);
+        std::size_t size = 0;
+        if (integer < 0) {
+          buffer[size++] = '-';
+        }
+        while (n > 0) {
+          buffer[size++] = digits[--n];
+        }
+        buffer[size] = '\0';
+        return size;
+      }
+
+      // the exact product a * b is hi + lo (Dekker).
+      void two_product(double a, double b, double& hi, double& lo) {
+        const double split = 134217729.0;
+        const double ca = split * a;
+        const double ah = ca - (ca - a);
+        const double al = a - ah;
+        const double cb = split * b;
+        const double bh = cb - (cb - b);
+        const double bl = b - bh;
+        hi = a * b;
+        lo = ((ah * bh - hi) + ah * bl + al * bh) + al * bl;
+      }
+
+      // %.14g rounds a float to 14 significant digits. the float scaled by
+      // an exact power of ten is hi + lo, with lo exact for the products
+      // and nearly exact for the quotients, so the rounding is exact unless
+      // the fraction is near one half. the floats near ties, and the floats
+      // out of range of the exact powers, go to snprintf.
+      std::size_t float2buffer(double number, char* buffer) {
+        const auto a = std::abs(number);
+        if (FLT_EVAL_METHOD == 0 && a >= 1e-8 && a < 1e34) {
+          std::uint64_t bits = 0;
+          std::memcpy(&bits, &a, sizeof(bits));
+          const int e2 = static_cast<int>(bits >> 52) - 1023;
+          int e = static_cast<int>(e2 * 0.30102999566398120) - (e2 < 0);
+          double hi = 0;
+          double lo = 0;
+          for (;; ++e) {
+            const int k = 13 - e;
+            if (k < 0) {
+              const double p = exact_pow10[-k];
+              hi = a / p;
+              double ph = 0;
+              double pl = 0;
+              two_product(hi, p, ph, pl);
+              lo = ((a - ph) - pl) / p;
+            } else {
+              two_product(a, exact_pow10[k], hi, lo);
+            }
+            if (hi < 1e14) {
+              break;
+            }
+          }
+          auto u = static_cast<std::uint64_t>(hi);
+          auto fraction = (hi - u) + lo;
+          if (fraction < 0) {
+            --u;
+            fraction += 1;
+          }
+          if (std::abs(fraction - 0.5) > 1e-7) {
+            if (fraction > 0.5 && ++u == 100000000000000ULL) {
+              u /= 10;
+              ++e;
+            }
+            char digits[14];
+            for (int i = 13; i >= 0; --i) {
+              digits[i] = '0' + u % 10;
+              u /= 10;
+            }
+            int n = 14;
+            while (n > 1 && digits[n - 1] == '0') {
+              --n;
+            }
+            std::size_t size = 0;
+            if (number < 0) {
+              buffer[size++] = '-';
+            }
+            if (e < -4 || e >= 14) {
+              buffer[size++] = digits[0];
+              if (n > 1) {
+                buffer[size++] = '.';
+                std::memcpy(buffer + size, digits + 1, n - 1);
+                size += n - 1;
+              }
+              buffer[size++] = 'e';
+              buffer[size++] = e < 0 ? '-' : '+';
+              const auto x = e < 0 ? -e : e;
+              if (x >= 10) {
+                buffer[size++] = '0' + x / 10;
+              } else {
+                buffer[size++] = '0';
+              }
+              buffer[size++] = '0' + x % 10;
+            } else if (e < 0) {
+              buffer[size++] = '0';
+              buffer[size++] = '.';
+              for (int i = -1; i > e; --i) {
+                buffer[size++] = '0';
+              }
+              std::memcpy(buffer + size, digits, n);
+              size += n;
+            } else {
+              for (int i = 0; i <= e; ++i) {
+                buffer[size++] = i < n ? digits[i] : '0';
+              }
+              buffer[size++] = '.';
+              if (n > e + 1) {
+                std::memcpy(buffer + size, digits + e + 1, n - e - 1);
+                size += n - e - 1;
+              } else {
+                buffer[size++] = '0';
+              }
+            }
+            buffer[size] = '\0';
+            return size;
+          }
+        }
+        std::size_t size = std::snprintf(buffer, number_size, "%.14g", number);
+        if (std::strspn(buffer, "-0123456789") == size) {
+          buffer[size++] = '.';
+          buffer[size++] = '0';
+          buffer[size] = '\0';
+        }
+        return size;
+      }
+
+      std::size_t number2buffer(const value_t& v, char* buffer) {
+        if (v.is_integer()) {
+          return integer2buffer(v.integer, buffer);
+        } else {
+          return float2buffer(v.number, buffer);
+        }
+      }
+
+      std::string number2str(const value_t& v) {
+        char buffer[number_size];
+        return std::string(buffer, number2buffer(v, buffer));
+      }
+
+      std::size_t mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+      }
+
+      std::size_t hash(const value_t& key) {
+        switch (key.type) {
+          case type_t::boolean:
+            return mix(key.boolean);
+          case type_t::integer:
+            return mix(key.integer);
+          case type_t::number:
+            {
+              std::int64_t integer = 0;
+              if (tointeger(key.number, integer)) {
+                return mix(integer);
+              } else {
+                return mix(std::hash<double>()(key.number));
+              }
+            }
+          case type_t::string:
+            return string_hash(*key.string);
+          case type_t::table:
+            return mix(reinterpret_cast<std::uintptr_t>(key.table.get()));
+          case type_t::function:
+            return mix(reinterpret_cast<std::uintptr_t>(key.function.get()));
+          default:
+            throw std::logic_error("unreachable code");
+        }
+      }
+
+      // the node part is an open addressing hash table with linear probing.
+      // its capacity is zero or a power of two and at most 3/4 of it is used.
+      bool node_find(const table_t& self, const value_t& key, std::size_t h, std::size_t& i) {
+        const auto mask = self.node.size() - 1;
+        for (i = h & mask; ; i = (i + 1) & mask) {
+          const auto& node = self.node[i];
+          if (node.key.is_nil()) {
+            return false;
+          }
+          if (node.hash == h && rawequal(node.key, key)) {
+            return true;
+          }
+        }
+      }
+
+      void node_insert(decltype(table_t::node)& nodes, value_t&& key, value_t&& value, std::size_t h) {
+        const auto mask = nodes.size() - 1;
+        auto i = h & mask;
+        while (!nodes[i].key.is_nil()) {
+          i = (i + 1) & mask;
+        }
+        auto& node = nodes[i];
+        node.key = std::move(key);
+        node.value = std::move(value);
+        node.hash = h;
+      }
+
+      void node_erase(table_t& self, std::size_t i) {
+        const auto mask = self.node.size() - 1;
+        for (auto j = (i + 1) & mask; !self.node[j].key.is_nil(); j = (j + 1) & mask) {
+          const auto k = self.node[j].hash & mask;
+          if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue;
+          }
+          self.node[i] = std::move(self.node[j]);
+          i = j;
+        }
+        auto& node = self.node[i];
+        node.key = NIL;
+        node.value = NIL;
+        --self.node_size;
+      }
+
+      std::size_t node_capacity(std::size_t size) {
+        std::size_t capacity = 0;
+        if (size > 0) {
+          capacity = 4;
+          while (capacity * 3 < size * 4) {
+            capacity *= 2;
+          }
+        }
+        return capacity;
+      }
+
+      // never destructed, as the string table.
+      shape_t* root_shape() {
+        static shape_t* instance = nullptr;
+        if (!instance) {
+          instance = new shape_t();
+          instance->count = 1;
+        }
+        return instance;
+      }
+
+      ptr_t<shape_t> transition(const ptr_t<shape_t>& shape, const value_t& key) {
+        auto* parent = shape ? shape.get() : root_shape();
+        for (auto* child : parent->children) {
+          if (child->keys.back().string == key.string) {
+            return ptr_t<shape_t>(child);
+          }
+        }
+        return make_ptr<shape_t>(ptr_t<shape_t>(parent), key);
+      }
+
+      // moves the keys in the slots to the node part.
+      void become_dynamic(table_t& self) {
+        self.dynamic = true;
+        const auto shape = std::move(self.shape);
+        decltype(self.slots) slots;
+        slots.swap(self.slots);
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          if (!slots[i].is_nil()) {
+            self.set(shape->keys[i], slots[i]);
+          }
+        }
+      }
+
+      // counts integer keys by slices (2^(i-1), 2^i]
+      void count_index(std::int64_t index, std::size_t* nums) {
+        const std::uint64_t x = index - 1;
+#ifdef __GNUC__
+        ++nums[x == 0 ? 0 : 64 - __builtin_clzll(x)];
+#else
+        std::size_t i = 0;
+        while ((x >> i) != 0) {
+          ++i;
+        }
+        ++nums[i];
+#endif
+      }
+
+      // rebuilds the table so that the array part has the largest size n
+      // such that more than half of the slots 1..n are in use, as Lua does.
+      void rehash(table_t& self, const value_t& key) {
+        std::size_t nums[64] = {};
+        std::size_t total = self.node_size + 1;
+        std::size_t total_index = 0;
+
+        for (std::size_t i = 0; i < self.array.size(); ++i) {
+          if (!self.array[i].is_nil()) {
+            count_index(i + 1, nums);
+            ++total;
+            ++total_index;
+          }
+        }
+        for (const auto& node : self.node) {
+          if (node.key.is_integer() && node.key.integer > 0) {
+            count_index(node.key.integer, nums);
+            ++total_index;
+          }
+        }
+        if (key.is_integer() && key.integer > 0) {
+          count_index(key.integer, nums);
+          ++total_index;
+        }
+
+        std::size_t array_size = 0;
+        std::size_t array_used = 0;
+        std::size_t used = 0;
+        for (std::size_t i = 0; i < 64 && (static_cast<std::uint64_t>(1) << i) / 2 < total_index; ++i) {
+          used += nums[i];
+          if (used > (static_cast<std::uint64_t>(1) << i) / 2) {
+            array_size = static_cast<std::uint64_t>(1) << i;
+            array_used = used;
+          }
+        }
+
+        decltype(self.array) array;
+        array.reserve(array_size);
+        decltype(self.node) nodes(node_capacity(total - array_used));
+        std::size_t node_size = 0;
+
+        for (std::size_t i = 0; i < self.array.size(); ++i) {
+          auto& value = self.array[i];
+          if (i < array_size) {
+            array.push_back(std::move(value));
+          } else if (!value.is_nil()) {
+            value_t k = i + 1;
+            const auto h = hash(k);
+            node_insert(nodes, std::move(k), std::move(value), h);
+            ++node_size;
+          }
+        }
+        array.resize(array_size);
+        for (auto& node : self.node) {
+          if (!node.key.is_nil()) {
+            const auto index = node.key.is_integer() ? node.key.integer : 0;
+            if (index > 0 && static_cast<std::uint64_t>(index) <= array_size) {
+              array[index - 1] = std::move(node.value);
+            } else {
+              node_insert(nodes, std::move(node.key), std::move(node.value), node.hash);
+              ++node_size;
+            }
+          }
+        }
+
+        self.array.swap(array);
+        self.node.swap(nodes);
+        self.node_size = node_size;
+      }
+
       void open_base(const value_t& env) {
         const value_t ipairs_iterator = [](value_t table, value_t index) -> array_t {
           index = index.checkinteger() + 1;
@@ -183,6 +893,37 @@ namespace dromozoa {
           }
         });
 
+        settable(env, "collectgarbage", [](value_t opt, value_t arg) -> value_t {
+          const auto option = opt.is_nil() ? std::string("collect") : opt.checkstring();
+          if (option == "collect") {
+            collect();
+            return 0;
+          } else if (option == "count") {
+            return gc.bytes / 1024.0;
+          } else if (option == "step") {
+            collect();
+            return true;
+          } else if (option == "isrunning") {
+            return gc.running;
+          } else if (option == "stop") {
+            gc.running = false;
+            return 0;
+          } else if (option == "restart") {
+            gc.running = true;
+            return 0;
+          } else if (option == "setpause") {
+            const auto pause = gc.pause;
+            gc.pause = arg.optinteger(0);
+            return pause;
+          } else if (option == "setstepmul") {
+            const auto stepmul = gc.stepmul;
+            gc.stepmul = arg.optinteger(0);
+            return stepmul;
+          } else {
+            throw value_t("bad argument #1 to 'collectgarbage' (invalid option '" + option + "')");
+          }
+        });
+
         settable(env, "error", [](value_t message) {
           throw message;
         });
@@ -238,8 +979,11 @@ namespace dromozoa {
         });
 
         settable(env, "tonumber", [](value_t v) -> value_t {
-          double result = 0;
-          if (v.tonumber(result)) {
+          if (v.is_number()) {
+            return v;
+          }
+          value_t result;
+          if (v.is_string() && str2number(v.string->data, v.string->size, result)) {
             return result;
           } else {
             return NIL;
@@ -259,14 +1003,14 @@ namespace dromozoa {
         value_t module = type_t::table;
 
         settable(module, "byte", [](value_t s, value_t i, value_t j) -> array_t {
-          const auto& string = s.checkstring();
+          const auto string = s.checkstring_ptr();
           const auto index = i.optinteger(1);
-          const auto min = range_i(index, string.size());
-          const auto max = range_j(j.optinteger(index), string.size());
+          const auto min = range_i(index, string->size);
+          const auto max = range_j(j.optinteger(index), string->size);
           if (min < max) {
             array_t result(max - min);
             for (std::size_t i = min; i < max; ++i) {
-              result[i - min] = static_cast<std::uint8_t>(string[i]);
+              result[i - min] = static_cast<std::uint8_t>(string->data[i]);
             }
             return result;
           } else {
@@ -288,15 +1032,15 @@ namespace dromozoa {
         });
 
         settable(module, "len", [](value_t s) -> value_t {
-          return s.checkstring().size();
+          return s.checkstring_ptr()->size;
         });
 
         settable(module, "sub", [](value_t s, value_t i, value_t j) -> value_t {
-          const auto& string = s.checkstring();
-          const auto min = range_i(i.optinteger(1), string.size());
-          const auto max = range_j(j.optinteger(string.size()), string.size());
+          const auto string = s.checkstring_ptr();
+          const auto min = range_i(i.optinteger(1), string->size);
+          const auto max = range_j(j.optinteger(string->size), string->size);
           if (min < max) {
-            return string.substr(min, max - min);
+            return make_substring(string, min, max - min);
           } else {
             return "";
           }
@@ -314,46 +1058,119 @@ namespace dromozoa {
       }
     }
 
+    gc_t gc = { 0, 1 << 20, 200, 200, true, false, nullptr };
+
     value_t NIL = type_t::nil;
     value_t FALSE = false;
     value_t TRUE = true;
     value_t string_metatable = type_t::table;
     value_t env = open(string_metatable);
 
-    value_t::value_t()
-      : mode(mode_t::variable),
-        type(type_t::nil) {}
-
-    value_t::value_t(const value_t& that)
-      : value_t() {
-      copy_construct(*this, that);
+    void value_t::copy_construct(const value_t& that) {
+      type = that.type;
+      switch (type) {
+        case type_t::nil:
+          break;
+        case type_t::boolean:
+          boolean = that.boolean;
+          break;
+        case type_t::integer:
+          integer = that.integer;
+          break;
+        case type_t::number:
+          number = that.number;
+          break;
+        case type_t::string:
+          new (&string) string_ptr(that.string);
+          break;
+        case type_t::table:
+          new (&table) table_ptr(that.table);
+          break;
+        case type_t::function:
+          new (&function) function_ptr(that.function);
+          break;
+        default:
+          throw std::logic_error("unreachable code");
+      }
     }
 
-    value_t::value_t(value_t&& that)
-      : value_t() {
-      move_construct(*this, std::move(that));
+    void value_t::move_construct(value_t&& that) {
+      type = that.type;
+      that.type = type_t::nil;
+      switch (type) {
+        case type_t::nil:
+          break;
+        case type_t::boolean:
+          boolean = that.boolean;
+          break;
+        case type_t::integer:
+          integer = that.integer;
+          break;
+        case type_t::number:
+          number = that.number;
+          break;
+        case type_t::string:
+          new (&string) string_ptr(std::move(that.string));
+          that.string.~string_ptr();
+          break;
+        case type_t::table:
+          new (&table) table_ptr(std::move(that.table));
+          that.table.~table_ptr();
+          break;
+        case type_t::function:
+          new (&function) function_ptr(std::move(that.function));
+          that.function.~function_ptr();
+          break;
+        default:
+          throw std::logic_error("unreachable code");
+      }
     }
 
-    value_t::~value_t() {
-      destruct(*this);
+    void value_t::destruct() {
+      switch (type) {
+        case type_t::nil:
+          break;
+        case type_t::boolean:
+          break;
+        case type_t::integer:
+          break;
+        case type_t::number:
+          break;
+        case type_t::string:
+          string.~string_ptr();
+          break;
+        case type_t::table:
+          table.~table_ptr();
+          break;
+        case type_t::function:
+          function.~function_ptr();
+          break;
+        default:
+          throw std::logic_error("unreachable code");
+      }
+      type = type_t::nil;
     }
 
-    value_t& value_t::operator=(const value_t& that) {
-      if (mode == mode_t::constant) {
-        throw std::logic_error("cannot assign to constant value");
+    // that may be owned by this, so it is copied before this is destructed.
+    // nil owns nothing, as the slots of the arrays being built.
+    void value_t::copy_assign(const value_t& that) {
+      if (type == type_t::nil) {
+        copy_construct(that);
+        return;
       }
-      destruct(*this);
-      copy_construct(*this, that);
-      return *this;
+      value_t value(that);
+      destruct();
+      move_construct(std::move(value));
     }
 
-    value_t& value_t::operator=(value_t&& that) {
-      if (mode == mode_t::constant) {
-        throw std::logic_error("cannot assign to constant value");
+    void value_t::move_assign(value_t&& that) {
+      if (type == type_t::nil) {
+        move_construct(std::move(that));
+        return;
       }
-      destruct(*this);
-      move_construct(*this, std::move(that));
-      return *this;
+      value_t value(std::move(that));
+      destruct();
+      move_construct(std::move(value));
     }
 
     value_t::value_t(type_t type)
@@ -365,57 +1182,54 @@ namespace dromozoa {
         case type_t::boolean:
           boolean = false;
           break;
+        case type_t::integer:
+          integer = 0;
+          break;
         case type_t::number:
           number = 0;
           break;
         case type_t::string:
-          new (&string) string_ptr(std::make_shared<std::string>());
+          new (&string) string_ptr(make_string(std::string()));
           break;
         case type_t::table:
-          new (&table) table_ptr(std::make_shared<table_t>());
+          new (&table) table_ptr(make_ptr<table_t>());
           break;
         case type_t::function:
-          new (&function) function_ptr(std::make_shared<noop_t>());
+          new (&function) function_ptr(make_ptr<noop_t>());
           break;
         default:
           throw std::logic_error("unreachable code");
       }
     }
 
-    value_t::value_t(bool boolean)
-      : mode(mode_t::constant),
-        type(type_t::boolean) {
-      this->boolean = boolean;
-    }
-
-    value_t::value_t(double number)
-      : mode(mode_t::constant),
-        type(type_t::number) {
-      this->number = number;
-    }
-
     value_t::value_t(const char* data)
       : mode(mode_t::constant),
         type(type_t::string) {
-      new (&this->string) string_ptr(std::make_shared<std::string>(data));
+      new (&this->string) string_ptr(make_string(data, std::strlen(data)));
     }
 
     value_t::value_t(const char* data, std::size_t size)
       : mode(mode_t::constant),
         type(type_t::string) {
-      new (&this->string) string_ptr(std::make_shared<std::string>(data, size));
+      new (&this->string) string_ptr(make_string(data, size));
     }
 
     value_t::value_t(const std::string& string)
       : mode(mode_t::constant),
         type(type_t::string) {
-      new (&this->string) string_ptr(std::make_shared<std::string>(string));
+      new (&this->string) string_ptr(make_string(string.data(), string.size()));
     }
 
     value_t::value_t(std::string&& string)
       : mode(mode_t::constant),
         type(type_t::string) {
-      new (&this->string) string_ptr(std::make_shared<std::string>(std::move(string)));
+      new (&this->string) string_ptr(make_string(std::move(string)));
+    }
+
+    value_t::value_t(string_ptr string)
+      : mode(mode_t::constant),
+        type(type_t::string) {
+      new (&this->string) string_ptr(string);
     }
 
     value_t::value_t(function_ptr function)
@@ -433,10 +1247,12 @@ namespace dromozoa {
           return false;
         case type_t::boolean:
           return boolean < that.boolean;
+        case type_t::integer:
+          return integer < that.integer;
         case type_t::number:
           return number < that.number;
         case type_t::string:
-          return *string < *that.string;
+          return string != that.string && string_lt(*string, *that.string);
         case type_t::table:
           return table < that.table;
         case type_t::function:
@@ -446,240 +1262,479 @@ namespace dromozoa {
       }
     }
 
-    bool value_t::is_nil() const {
-      return type == type_t::nil;
+    bool value_t::tonumber(double& result) const {
+      if (is_number()) {
+        result = tofloat();
+        return true;
+      } else if (is_string()) {
+        value_t value;
+        if (str2number(string->data, string->size, value)) {
+          result = value.tofloat();
+          return true;
+        }
+      }
+      return false;
+    }
+
+    double value_t::checknumber() const {
+      double result = 0;
+      if (tonumber(result)) {
+        return result;
+      }
+      throw value_t("number expected, got " + dromozoa::runtime::type(*this));
+    }
+
+    std::int64_t value_t::checkinteger() const {
+      if (is_integer()) {
+        return integer;
+      }
+      value_t value;
+      if (is_float()) {
+        value = *this;
+      } else if (!is_string() || !str2number(string->data, string->size, value)) {
+        throw value_t("integer expected, got " + dromozoa::runtime::type(*this));
+      }
+      if (value.is_integer()) {
+        return value.integer;
+      }
+      std::int64_t result = 0;
+      if (tointeger(value.number, result)) {
+        return result;
+      }
+      throw value_t("number has no integer representation");
+    }
+
+    std::string value_t::checkstring() const {
+      if (is_string()) {
+        return std::string(string->data, string->size);
+      } else if (is_number()) {
+        return number2str(*this);
+      }
+      throw value_t("string expected, got " + dromozoa::runtime::type(*this));
+    }
+
+    string_ptr value_t::checkstring_ptr() const {
+      if (is_string()) {
+        return string;
+      } else if (is_number()) {
+        return make_string(number2str(*this));
+      }
+      throw value_t("string expected, got " + dromozoa::runtime::type(*this));
+    }
+
+    table_ptr value_t::checktable() const {
+      if (is_table()) {
+        return table;
+      }
+      throw value_t("table expected, got " + dromozoa::runtime::type(*this));
+    }
+
+    std::int64_t value_t::optinteger(std::int64_t d) const {
+      if (is_nil()) {
+        return d;
+      } else {
+        return checkinteger();
+      }
+    }
+
+    std::size_t collect() {
+      if (gc.collecting) {
+        return 0;
+      }
+      gc.collecting = true;
+
+      // the references from outside the containers are what remains of the
+      // counts after the references between them are subtracted.
+      std::vector<container_t*> objects;
+      for (auto* object = gc.head; object; object = object->next) {
+        object->refs = object->count;
+        object->marked = false;
+        objects.push_back(object);
+      }
+      subtract_t subtract;
+      for (auto* object : objects) {
+        object->traverse(subtract);
+      }
+
+      // containers referenced from outside, and those under construction, are
+      // roots.
+      mark_t mark;
+      for (auto* object : objects) {
+        if (object->refs > 0 || object->count == 0) {
+          mark(object);
+        }
+      }
+      while (!mark.stack.empty()) {
+        auto* object = mark.stack.back();
+        mark.stack.pop_back();
+        object->traverse(mark);
+      }
+
+      // hold the garbage while the cycles are broken.
+      std::vector<container_t*> garbage;
+      for (auto* object : objects) {
+        if (!object->marked) {
+          ++object->count;
+          garbage.push_back(object);
+        }
+      }
+      for (auto* object : garbage) {
+        object->clear();
+      }
+      for (auto* object : garbage) {
+        if (--object->count == 0) {
+          delete object;
+        }
+      }
+
+      gc.threshold = gc.bytes / 100 * gc.pause;
+      gc.collecting = false;
+      return garbage.size();
+    }
+
+#ifdef __GNUC__
+    __attribute__((noinline))
+#endif
+    void deallocate(void* ptr) {
+      ::operator delete(ptr);
     }
 
-    bool value_t::is_boolean() const {
-      return type == type_t::boolean;
+    container_t::container_t()
+      : prev(),
+        next(),
+        refs(),
+        marked() {
+      if (gc.running && gc.bytes > gc.threshold) {
+        collect();
+      }
+      next = gc.head;
+      if (next) {
+        next->prev = this;
+      }
+      gc.head = this;
     }
 
-    bool value_t::is_number() const {
-      return type == type_t::number;
+    container_t::container_t(const container_t&)
+      : container_t() {}
+
+    container_t::~container_t() {
+      if (prev) {
+        prev->next = next;
+      } else {
+        gc.head = next;
+      }
+      if (next) {
+        next->prev = prev;
+      }
     }
 
-    bool value_t::is_string() const {
-      return type == type_t::string;
+    string_t::string_t(std::string&& buffer, std::size_t hash)
+      : buffer(std::move(buffer)),
+        data(this->buffer.data()),
+        size(this->buffer.size()),
+        hash(hash),
+        hashed(true),
+        interned() {
+      gc.bytes += this->buffer.capacity();
     }
 
-    bool value_t::is_table() const {
-      return type == type_t::table;
+    string_t::string_t(ptr_t<string_t> parent, std::size_t begin, std::size_t size)
+      : parent(parent),
+        data(parent->data + begin),
+        size(size),
+        hash(),
+        hashed(),
+        interned() {}
+
+    string_t::~string_t() {
+      gc.bytes -= buffer.capacity();
+      if (interned) {
+        auto& table = string_table();
+        const auto range = table.equal_range(hash);
+        for (auto i = range.first; i != range.second; ++i) {
+          if (i->second == this) {
+            table.erase(i);
+            break;
+          }
+        }
+      }
     }
 
-    bool value_t::is_function() const {
-      return type == type_t::function;
+    shape_t::shape_t()
+      : expected() {}
+
+    shape_t::shape_t(ptr_t<shape_t> parent, const value_t& key)
+      : parent(parent),
+        keys(parent->keys),
+        expected() {
+      keys.push_back(key);
+      parent->children.push_back(this);
+      const auto n = keys.size();
+      for (auto* shape = parent.get(); shape; shape = shape->parent.get()) {
+        if (shape->expected < n) {
+          shape->expected = n;
+        }
+      }
     }
 
-    bool value_t::toboolean() const {
-      if (is_nil()) {
-        return false;
-      } else if (is_boolean()) {
-        return boolean;
+    shape_t::~shape_t() {
+      if (parent) {
+        auto& children = parent->children;
+        children.erase(std::find(children.begin(), children.end(), this));
       }
-      return true;
     }
 
-    bool value_t::tonumber(double& result) const {
-      if (is_number()) {
-        result = number;
-        return true;
-      } else if (is_string()) {
-        auto n = string->find_last_not_of(" \f\n\r\t\v");
-        if (n != std::string::npos) {
-          ++n;
-          try {
-            std::size_t i = 0;
-            const std::int64_t integer = std::stoll(*string, &i, 10);
-            if (i == n) {
-              result = integer;
-              return true;
-            }
-          } catch (const std::exception&) {}
-          if (is_hexint(*string)) {
-            try {
-              std::size_t i = 0;
-              const std::int64_t integer = std::stoll(*string, &i, 16);
-              if (i == n) {
-                result = integer;
-                return true;
-              }
-            } catch (const std::exception&) {}
-          }
-          try {
-            std::size_t i = 0;
-            const double number = std::stod(*string, &i);
-            if (i == n) {
-              result = number;
-              return true;
-            }
-          } catch (const std::exception&) {}
-        }
+    table_t::table_t()
+      : node_size(),
+        dynamic(),
+        flags() {}
+
+    void table_t::traverse(visitor_t& visit) {
+      for (const auto& value : array) {
+        visit(value);
       }
-      return false;
+      for (const auto& node : this->node) {
+        visit(node.key);
+        visit(node.value);
+      }
+      for (const auto& value : slots) {
+        visit(value);
+      }
+      visit(metatable);
     }
 
-    double value_t::checknumber() const {
-      double result = 0;
-      if (tonumber(result)) {
-        return result;
+    void table_t::clear() {
+      decltype(array)().swap(array);
+      decltype(node)().swap(node);
+      node_size = 0;
+      shape = nullptr;
+      decltype(slots)().swap(slots);
+      dynamic = false;
+      metatable = NIL;
+      flags = 0;
+    }
+
+    // float keys with integer values are normalized to integers, so 1 and 1.0
+    // are the same key.
+    const value_t& table_t::get(const value_t& key) const {
+      if (key.is_integer()) {
+        const auto index = key.integer;
+        if (index > 0 && static_cast<std::uint64_t>(index) <= array.size()) {
+          return array[index - 1];
+        }
+      } else if (key.is_float()) {
+        std::int64_t index = 0;
+        if (tointeger(key.number, index)) {
+          return get(index);
+        }
       }
-      throw value_t("number expected, got " + dromozoa::runtime::type(*this));
+      if (shape && key.is_string()) {
+        const auto i = shape->find(key.string.get());
+        if (i < slots.size()) {
+          return slots[i];
+        }
+      }
+      if (node_size > 0 && !key.is_nil()) {
+        std::size_t i = 0;
+        if (node_find(*this, key, hash(key), i)) {
+          return node[i].value;
+        }
+      }
+      return NIL;
     }
 
-    std::int64_t value_t::checkinteger() const {
-      if (is_number()) {
-        if (std::isfinite(number) && number == std::floor(number)) {
-          return number;
-        } else {
-          throw value_t("number has no integer representation");
+    void table_t::set(const value_t& key, const value_t& value) {
+      if (key.is_nil()) {
+        throw value_t("table index is nil");
+      }
+      if (key.is_float()) {
+        if (std::isnan(key.number)) {
+          throw value_t("table index is NaN");
         }
-      } else if (is_string()) {
-        auto n = string->find_last_not_of(" \f\n\r\t\v");
-        if (n != std::string::npos) {
-          ++n;
-          try {
-            std::size_t i = 0;
-            const std::int64_t integer = std::stoll(*string, &i, 10);
-            if (i == n) {
-              return integer;
-            }
-          } catch (const std::exception&) {}
-          if (is_hexint(*string)) {
-            try {
-              std::size_t i = 0;
-              const std::int64_t integer = std::stoll(*string, &i, 16);
-              if (i == n) {
-                return integer;
-              }
-            } catch (const std::exception&) {}
+        std::int64_t index = 0;
+        if (tointeger(key.number, index)) {
+          return set(index, value);
+        }
+      }
+      flags = 0;
+      if (key.is_string()) {
+        if (shape) {
+          const auto i = shape->find(key.string.get());
+          if (i < slots.size()) {
+            slots[i] = value;
+            return;
           }
-          try {
+        }
+        if (!dynamic && key.string->size <= DROMOZOA_COMPILER_RUNTIME_SHORT_STRING_MAX && !value.is_nil()) {
+          if (slots.size() < shape_t::max_size) {
+            shape = transition(shape, key);
+            if (slots.empty()) {
+              slots.reserve(shape->expected);
+            }
+            slots.push_back(value);
+            return;
+          }
+          become_dynamic(*this);
+        }
+      }
+      if (key.is_integer()) {
+        const auto index = key.integer;
+        if (index > 0) {
+          const auto n = array.size();
+          if (static_cast<std::uint64_t>(index) <= n) {
+            array[index - 1] = value;
+            return;
+          }
+          if (static_cast<std::uint64_t>(index) == n + 1 && !value.is_nil()) {
             std::size_t i = 0;
-            const double number = std::stod(*string, &i);
-            if (i == n) {
-              if (std::isfinite(number) && number == std::floor(number)) {
-                return number;
-              } else {
-                throw value_t("number has no integer representation");
+            if (node_size > 0 && node_find(*this, key, hash(key), i)) {
+              node_erase(*this, i);
+            }
+            array.push_back(value);
+            // migrate the keys that follow from the node part
+            while (node_size > 0) {
+              const value_t next = array.size() + 1;
+              if (!node_find(*this, next, hash(next), i)) {
+                break;
               }
+              array.push_back(std::move(node[i].value));
+              node_erase(*this, i);
             }
-          } catch (const std::exception&) {}
+            return;
+          }
         }
       }
-      throw value_t("integer expected, got " + dromozoa::runtime::type(*this));
-    }
 
-    std::string value_t::checkstring() const {
-      if (is_string()) {
-        return *string;
-      } else if (is_number()) {
-        std::ostringstream out;
-        out << std::setprecision(17) << number;
-        return out.str();
+      const auto h = hash(key);
+      std::size_t i = 0;
+      if (!node.empty() && node_find(*this, key, h, i)) {
+        if (value.is_nil()) {
+          node_erase(*this, i);
+        } else {
+          node[i].value = value;
+        }
+        return;
       }
-      throw value_t("string expected, got " + dromozoa::runtime::type(*this));
-    }
-
-    table_ptr value_t::checktable() const {
-      if (is_table()) {
-        return table;
+      if (value.is_nil()) {
+        return;
       }
-      throw value_t("table expected, got " + dromozoa::runtime::type(*this));
-    }
-
-    std::int64_t value_t::optinteger(std::int64_t d) const {
-      if (is_nil()) {
-        return d;
-      } else {
-        return checkinteger();
+      if ((node_size + 1) * 4 > node.size() * 3) {
+        rehash(*this, key);
+        return set(key, value);
       }
+      // node_find stopped at the empty node where the key goes
+      auto& slot = node[i];
+      slot.key = key;
+      slot.value = value;
+      slot.hash = h;
+      ++node_size;
     }
 
-    const value_t& table_t::get(const value_t& index) const {
-      const auto i = map.find(index);
-      if (i == map.end()) {
-        return NIL;
-      } else {
-        return i->second;
+    std::int64_t table_t::len() const {
+      std::size_t j = array.size();
+      if (j > 0 && array[j - 1].is_nil()) {
+        // binary search for a border in the array part
+        std::size_t i = 0;
+        while (j - i > 1) {
+          const auto m = (i + j) / 2;
+          if (array[m - 1].is_nil()) {
+            j = m;
+          } else {
+            i = m;
+          }
+        }
+        return i;
       }
-    }
-
-    void table_t::set(const value_t& index, const value_t& value) {
-      if (index.is_nil()) {
-        throw value_t("table index is nil");
+      if (node_size == 0) {
+        return j;
       }
-      if (value.is_nil()) {
-        map.erase(index);
-      } else {
-        map[index] = value;
+      // unbound search in the node part
+      std::int64_t i = j;
+      std::int64_t k = j + 1;
+      while (!get(k).is_nil()) {
+        i = k;
+        if (k > std::numeric_limits<std::int64_t>::max() / 2) {
+          std::int64_t n = 1;
+          while (!get(n).is_nil()) {
+            ++n;
+          }
+          return n - 1;
+        }
+        k *= 2;
+      }
+      while (k - i > 1) {
+        const auto m = (i + k) / 2;
+        if (get(m).is_nil()) {
+          k = m;
+        } else {
+          i = m;
+        }
       }
+      return i;
     }
 
-    array_t::array_t()
-      : size() {}
-
     array_t::array_t(std::size_t n)
-      : array_t() {
-      if (n > 0) {
-        data = std::shared_ptr<value_t>(new value_t[n], std::default_delete<value_t[]>());
-        size = n;
+      : size(n) {
+      if (size > inline_size) {
+        block = ptr_t<block_t<value_t>>(block_t<value_t>::create(size));
       }
     }
 
-    array_t::array_t(std::initializer_list<value_t> source)
-      : array_t() {
-      const auto n = source.size();
-      if (n > 0) {
-        data = std::shared_ptr<value_t>(new value_t[n], std::default_delete<value_t[]>());
-        size = n;
-        auto* ptr = data.get();
-        for (const auto& value : source) {
-          *ptr++ = value;
-        }
+    array_t::array_t(std::initializer_list<value_t> source, const array_t& array)
+      : array_t(source.size() + array.size) {
+      auto* ptr = block ? block->data() : values;
+      for (const auto& value : source) {
+        *ptr++ = value;
+      }
+      const auto* data = array.data();
+      for (std::size_t i = 0; i < array.size; ++i) {
+        *ptr++ = data[i];
       }
     }
 
-    array_t::array_t(std::initializer_list<value_t> source, array_t array)
-      : array_t() {
-      const auto n = source.size() + array.size;
-      if (n > 0) {
-        data = std::shared_ptr<value_t>(new value_t[n], std::default_delete<value_t[]>());
-        size = n;
-        auto* ptr = data.get();
-        for (const auto& value : source) {
-          *ptr++ = value;
+    array_t::array_t(std::initializer_list<value_t> source, array_t&& array)
+      : array_t(source.size() + array.size) {
+      auto* ptr = block ? block->data() : values;
+      for (const auto& value : source) {
+        *ptr++ = value;
+      }
+      if (array.owns()) {
+        auto* data = array.block ? array.block->data() : array.values;
+        for (std::size_t i = 0; i < array.size; ++i) {
+          *ptr++ = std::move(data[i]);
         }
+      } else {
+        const auto* data = array.data();
         for (std::size_t i = 0; i < array.size; ++i) {
-          *ptr++ = array.data.get()[i];
+          *ptr++ = data[i];
         }
       }
     }
 
-    array_t::array_t(const value_t& value, array_t array) {
-      const auto n = array.size + 1;
-      data = std::shared_ptr<value_t>(new value_t[n], std::default_delete<value_t[]>());
-      size = n;
-      auto* ptr = data.get();
+    array_t::array_t(const value_t& value, const array_t& array)
+      : array_t(array.size + 1) {
+      auto* ptr = block ? block->data() : values;
       *ptr++ = value;
+      const auto* data = array.data();
       for (std::size_t i = 0; i < array.size; ++i) {
-        *ptr++ = array.data.get()[i];
+        *ptr++ = data[i];
       }
     }
 
-    value_t& array_t::operator[](std::size_t i) const {
-      if (i < size) {
-        return data.get()[i];
-      } else {
-        return NIL;
-      }
-    }
+    array_t::array_t(const value_t& value, array_t&& array)
+      : array_t({ value }, std::move(array)) {}
 
+    // the arrays are not modified once built, so the whole array shares the
+    // block.
     array_t array_t::sub(std::size_t begin) const {
-      if (size > begin) {
+      if (begin == 0) {
+        return *this;
+      } else if (size > begin) {
         array_t that(size - begin);
-        auto* ptr = that.data.get();
+        auto* ptr = that.block ? that.block->data() : that.values;
+        const auto* data = this->data();
         for (std::size_t i = begin; i < size; ++i) {
-          *ptr++ = data.get()[i];
+          *ptr++ = data[i];
         }
         return that;
       } else {
@@ -690,7 +1745,7 @@ namespace dromozoa {
     array_t array_t::sub(std::size_t begin, std::size_t end) const {
       if (end > begin) {
         array_t that(end - begin);
-        auto* ptr = that.data.get();
+        auto* ptr = that.block ? that.block->data() : that.values;
         for (std::size_t i = begin; i < end; ++i) {
           *ptr++ = (*this)[i];
         }
@@ -700,15 +1755,42 @@ namespace dromozoa {
       }
     }
 
+    registers_t::registers_t()
+      : size() {}
+
+    registers_t::registers_t(std::size_t n)
+      : registers_t() {
+      if (n > 0) {
+        block = ptr_t<block_t<value_t>>(block_t<value_t>::create(n));
+        size = n;
+      }
+    }
+
+    registers_t::registers_t(std::initializer_list<value_t> source)
+      : registers_t(source.size()) {
+      auto* ptr = block ? block->data() : nullptr;
+      for (const auto& value : source) {
+        *ptr++ = value;
+      }
+    }
+
+    value_t& registers_t::operator[](std::size_t i) const {
+      if (i < size) {
+        return block->data()[i];
+      } else {
+        return NIL;
+      }
+    }
+
     upvalue_t::upvalue_t()
       : index() {}
 
-    upvalue_t::upvalue_t(array_t array, std::size_t index)
-      : array(array),
+    upvalue_t::upvalue_t(registers_t registers, std::size_t index)
+      : registers(registers),
         index(index) {}
 
     value_t& upvalue_t::operator*() const {
-      return array[index];
+      return registers[index];
     }
 
     uparray_t::uparray_t()
@@ -718,9 +1800,9 @@ namespace dromozoa {
       : uparray_t() {
       const auto n = source.size();
       if (n > 0) {
-        data = std::shared_ptr<upvalue_t>(new upvalue_t[n], std::default_delete<upvalue_t[]>());
+        block = ptr_t<block_t<upvalue_t>>(block_t<upvalue_t>::create(n));
         size = n;
-        auto* ptr = data.get();
+        auto* ptr = block->data();
         for (const auto& upvalue : source) {
           *ptr++ = upvalue;
         }
@@ -729,12 +1811,20 @@ namespace dromozoa {
 
     upvalue_t& uparray_t::operator[](std::size_t i) const {
       if (i < size) {
-        return data.get()[i];
+        return block->data()[i];
       } else {
         throw std::out_of_range("invalid uparray index");
       }
     }
 
+    value_t intern(const char* data, std::size_t size) {
+      const auto hash = hash_string(data, size);
+      if (auto string = find_string(data, size, hash)) {
+        return string;
+      }
+      return insert_string(std::string(data, size), hash);
+    }
+
     const value_t& rawget(const value_t& table, const value_t& index) {
       return table.checktable()->get(index);
     }
@@ -745,14 +1835,14 @@ namespace dromozoa {
     }
 
     const value_t& getmetafield(const value_t& object, const value_t& event) {
-      value_t metatable;
+      const value_t* metatable = &NIL;
       if (object.is_string()) {
-        metatable = string_metatable;
+        metatable = &string_metatable;
       } else if (object.is_table()) {
-        metatable = object.table->metatable;
+        metatable = &object.table->metatable;
       }
-      if (metatable.is_table()) {
-        return rawget(metatable, event);
+      if (metatable->is_table()) {
+        return rawget(*metatable, event);
       } else {
         return NIL;
       }
@@ -763,11 +1853,9 @@ namespace dromozoa {
         return string_metatable;
       } else if (object.is_table()) {
         const auto& metatable = object.table->metatable;
-        if (metatable.is_table()) {
-          const auto& protected_metatable = rawget(metatable, "__metatable");
-          if (!protected_metatable.is_nil()) {
-            return protected_metatable;
-          }
+        const auto& protected_metatable = metafield(metatable, event_t::metatable);
+        if (!protected_metatable.is_nil()) {
+          return protected_metatable;
         }
         return metatable;
       } else {
@@ -779,7 +1867,7 @@ namespace dromozoa {
       if (!metatable.is_nil() && !metatable.is_table()) {
         throw value_t("nil or table expected");
       }
-      if (!getmetafield(table, "__metatable").is_nil()) {
+      if (!getmetafield(table, event_t::metatable).is_nil()) {
         throw value_t("cannot change a protected metatable");
       }
       table.checktable()->metatable = metatable;
@@ -788,7 +1876,7 @@ namespace dromozoa {
 
     value_t gettable(const value_t& table, const value_t& index) {
       if (table.is_string()) {
-        const auto& field = getmetafield(table, "__index");
+        const auto& field = getmetafield(table, event_t::index);
         if (!field.is_nil()) {
           if (field.is_function()) {
             return call1(field, { table, index });
@@ -799,7 +1887,7 @@ namespace dromozoa {
       }
       const auto& result = rawget(table, index);
       if (result.is_nil()) {
-        const auto& field = getmetafield(table, "__index");
+        const auto& field = getmetafield(table, event_t::index);
         if (!field.is_nil()) {
           if (field.is_function()) {
             return call1(field, { table, index });
@@ -814,7 +1902,7 @@ namespace dromozoa {
     void settable(const value_t& table, const value_t& index, const value_t& value) {
       const auto& result = rawget(table, index);
       if (result.is_nil()) {
-        const auto& field = getmetafield(table, "__newindex");
+        const auto& field = getmetafield(table, event_t::newindex);
         if (!field.is_nil()) {
           if (field.is_function()) {
             return call0(field, { table, index, value });
@@ -826,13 +1914,79 @@ namespace dromozoa {
       rawset(table, index, value);
     }
 
+    value_t getfield_miss(const value_t& table, const value_t& key, cache_t& cache) {
+      if (!table.is_table()) {
+        return gettable(table, key);
+      }
+      const auto& self = *table.table;
+      std::size_t i = 0;
+      if (self.shape) {
+        i = self.shape->find(key.string.get());
+        if (i < self.slots.size() && !self.slots[i].is_nil()) {
+          cache.shape = self.shape;
+          cache.index = i;
+          return self.slots[i];
+        }
+      }
+      if (self.node_size > 0 && node_find(self, key, string_hash(*key.string), i)) {
+        cache.shape = nullptr;
+        cache.index = i;
+        return self.node[i].value;
+      }
+      const auto& field = getmetafield(table, event_t::index);
+      if (field.is_nil()) {
+        return NIL;
+      } else if (field.is_function()) {
+        return call1(field, { table, key });
+      } else {
+        // the cache follows the __index chain, so that it hits where the
+        // key is found.
+        return getfield(field, key, cache);
+      }
+    }
+
+    void setfield_miss(const value_t& table, const value_t& key, const value_t& value, cache_t& cache) {
+      if (table.is_table()) {
+        auto& self = *table.table;
+        std::size_t i = 0;
+        if (self.shape) {
+          i = self.shape->find(key.string.get());
+          if (i < self.slots.size() && !self.slots[i].is_nil()) {
+            self.flags = 0;
+            self.slots[i] = value;
+            if (!value.is_nil()) {
+              cache.shape = self.shape;
+              cache.index = i;
+            }
+            return;
+          }
+        }
+        if (self.node_size > 0 && node_find(self, key, string_hash(*key.string), i)) {
+          self.flags = 0;
+          if (value.is_nil()) {
+            node_erase(self, i);
+          } else {
+            self.node[i].value = value;
+            cache.shape = nullptr;
+            cache.index = i;
+          }
+          return;
+        }
+      }
+      settable(table, key, value);
+    }
+
     void setlist(const value_t& table, std::size_t index, const value_t& value) {
-      rawset(table, index, value);
+      table.checktable()->set(index, value);
     }
 
     void setlist(const value_t& table, std::size_t index, const array_t& array) {
+      const auto& t = table.checktable();
+      if (index == t->array.size() + 1) {
+        t->array.reserve(index - 1 + array.size);
+      }
       for (size_t i = 0; i < array.size; ++i) {
-        rawset(table, index++, array[i]);
+        t->set(index++, array[i]);
       }
     }
 
@@ -840,7 +1994,7 @@ namespace dromozoa {
       if (f.is_function()) {
         return (*f.function)(args);
       } else {
-        const auto& field = getmetafield(f, "__call");
+        const auto& field = getmetafield(f, event_t::call);
         if (field.is_function()) {
           return (*field.function)(array_t(f, args));
         } else {
@@ -850,19 +2004,28 @@ namespace dromozoa {
     }
 
     value_t call1(const value_t& f, const array_t& args) {
-      return call(f, args)[0];
+      return first(call(f, args));
     }
 
     void call0(const value_t& f, const array_t& args) {
       call(f, args);
     }
 
+    value_t first(array_t&& results) {
+      if (results.owns()) {
+        return std::move(results[0]);
+      } else {
+        return results[0];
+      }
+    }
+
     std::string type(const value_t& v) {
       switch (v.type) {
         case type_t::nil:
           return "nil";
         case type_t::boolean:
           return "boolean";
+        case type_t::integer:
         case type_t::number:
           return "number";
         case type_t::string:
@@ -886,17 +2049,14 @@ namespace dromozoa {
           } else {
             return "false";
           }
+        case type_t::integer:
         case type_t::number:
-          {
-            std::ostringstream out;
-            out << std::setprecision(17) << v.number;
-            return out.str();
-          }
+          return number2str(v);
         case type_t::string:
-          return *v.string;
+          return std::string(v.string->data, v.string->size);
         case type_t::table:
           {
-            const auto& field = getmetafield(v, "__tostring");
+            const auto& field = getmetafield(v, event_t::tostring);
             if (!field.is_nil()) {
               return call1(field, { v }).checkstring();
             } else {
@@ -918,23 +2078,67 @@ namespace dromozoa {
 
     std::int64_t len(const value_t& v) {
       if (v.is_string()) {
-        return v.string->size();
+        return v.string->size;
       } else if (v.is_table()) {
-        const auto& field = getmetafield(v, "__len");
+        const auto& field = getmetafield(v, event_t::len);
         if (!field.is_nil()) {
           return call1(field, { v }).checkinteger();
         }
-        for (std::int64_t i = 1; ; ++i) {
-          if (gettable(v, i).is_nil()) {
-            return i - 1;
+        return v.table->len();
+      }
+      throw value_t("attempt to get length of a " + type(v) + " value");
+    }
+
+    // the numbers are formatted on the stack in the first pass, as long as
+    // they fit, and then appended with the strings.
+    value_t concat(std::initializer_list<const value_t*> operands) {
+      char numbers[number_size * 8];
+      char* end = numbers;
+      std::size_t size = 0;
+      for (const auto* operand : operands) {
+        if (operand->is_string()) {
+          size += operand->string->size;
+        } else if (operand->is_number()) {
+          if (end + number_size <= numbers + sizeof(numbers)) {
+            const auto n = number2buffer(*operand, end);
+            size += n;
+            end += n + 1;
+          } else {
+            char buffer[number_size];
+            size += number2buffer(*operand, buffer);
           }
+        } else {
+          throw value_t("string expected, got " + type(*operand));
         }
       }
-      throw value_t("attempt to get length of a " + type(v) + " value");
+
+      std::string result;
+      result.reserve(size);
+      const char* number = numbers;
+      for (const auto* operand : operands) {
+        if (operand->is_string()) {
+          result.append(operand->string->data, operand->string->size);
+        } else if (number < end) {
+          const auto n = std::strlen(number);
+          result.append(number, n);
+          number += n + 1;
+        } else {
+          char buffer[number_size];
+          result.append(buffer, number2buffer(*operand, buffer));
+        }
+      }
+      return value_t(std::move(result));
     }
 
     bool rawequal(const value_t& self, const value_t& that) {
       if (self.type != that.type) {
+        // an integer and a float are equal if they have the same value.
+        std::int64_t integer = 0;
+        if (self.is_integer() && that.is_float()) {
+          return tointeger(that.number, integer) && integer == self.integer;
+        } else if (self.is_float() && that.is_integer()) {
+          return tointeger(self.number, integer) && integer == that.integer;
+        }
         return false;
       }
       switch (self.type) {
@@ -942,10 +2146,20 @@ namespace dromozoa {
           return true;
         case type_t::boolean:
           return self.boolean == that.boolean;
+        case type_t::integer:
+          return self.integer == that.integer;
         case type_t::number:
           return self.number == that.number;
         case type_t::string:
-          return *self.string == *that.string;
+          if (self.string == that.string) {
+            return true;
+          } else if (self.string->interned && that.string->interned) {
+            return false;
+          } else {
+            const auto& a = *self.string;
+            const auto& b = *that.string;
+            return (!a.hashed || !b.hashed || a.hash == b.hash) && string_eq(a, b);
+          }
         case type_t::table:
           return self.table == that.table;
         case type_t::function:
@@ -955,59 +2169,166 @@ namespace dromozoa {
       }
     }
 
-    bool eq(const value_t& self, const value_t& that) {
-      if (rawequal(self, that)) {
-        return true;
+    value_t arith(arith_t op, const value_t& self, const value_t& that) {
+      switch (op) {
+        case arith_t::band:
+          return self.checkinteger() & that.checkinteger();
+        case arith_t::bor:
+          return self.checkinteger() | that.checkinteger();
+        case arith_t::bxor:
+          return self.checkinteger() ^ that.checkinteger();
+        case arith_t::shl:
+          return shl(self.checkinteger(), that.checkinteger());
+        case arith_t::shr:
+          return shr(self.checkinteger(), that.checkinteger());
+        case arith_t::bnot:
+          return ~self.checkinteger();
+        default:
+          break;
       }
-      if (self.is_table() && that.is_table()) {
-        auto field = getmetafield(self, "__eq");
-        if (field.is_nil()) {
-          field = getmetafield(that, "__eq");
-        }
-        if (!field.is_nil()) {
-          return call1(field, { self, that }).toboolean();
+
+      if (self.is_integer() && that.is_integer()) {
+        const auto x = self.integer;
+        const auto y = that.integer;
+        switch (op) {
+          case arith_t::add:
+            return add(x, y);
+          case arith_t::sub:
+            return sub(x, y);
+          case arith_t::mul:
+            return mul(x, y);
+          case arith_t::mod:
+            if (y == 0) {
+              throw value_t("attempt to perform 'n%0'");
+            } else if (y == -1) {
+              return 0;
+            } else {
+              const auto r = x % y;
+              return r != 0 && (r ^ y) < 0 ? r + y : r;
+            }
+          case arith_t::idiv:
+            if (y == 0) {
+              throw value_t("attempt to perform 'n//0'");
+            } else if (y == -1) {
+              return unm(x);
+            } else {
+              const auto q = x / y;
+              return x % y != 0 && (x ^ y) < 0 ? q - 1 : q;
+            }
+          case arith_t::unm:
+            return unm(x);
+          default:
+            break;
         }
       }
-      return false;
+
+      // strings are converted to floats.
+      const double x = self.checknumber();
+      const double y = that.checknumber();
+      switch (op) {
+        case arith_t::add:
+          return x + y;
+        case arith_t::sub:
+          return x - y;
+        case arith_t::mul:
+          return x * y;
+        case arith_t::mod:
+          return mod(x, y);
+        case arith_t::pow:
+          return std::pow(x, y);
+        case arith_t::div:
+          return x / y;
+        case arith_t::idiv:
+          return std::floor(x / y);
+        case arith_t::unm:
+          return -x;
+        default:
+          throw std::logic_error("unreachable code");
+      }
     }
 
-    bool lt(const value_t& self, const value_t& that) {
-      if (self.is_number() && that.is_number()) {
-        return self.number < that.number;
-      } else if (self.is_string() && that.is_string()) {
-        return *self.string < *that.string;
-      } else {
-        auto field = getmetafield(self, "__lt");
-        if (field.is_nil()) {
-          field = getmetafield(that, "__lt");
-        }
-        if (!field.is_nil()) {
-          return call1(field, { self, that }).toboolean();
-        }
+    value_t tonumber(const value_t& v) {
+      if (v.is_number()) {
+        return v;
       }
-      throw value_t("attempt to compare " + type(self) + " with " + type(that));
+      return v.checknumber();
     }
 
-    bool le(const value_t& self, const value_t& that) {
-      if (self.is_number() && that.is_number()) {
-        return self.number <= that.number;
-      } else if (self.is_string() && that.is_string()) {
-        return *self.string <= *that.string;
+    std::int64_t forlimit(const value_t& limit, std::int64_t step) {
+      if (limit.is_integer()) {
+        return limit.integer;
+      }
+      double number = limit.checknumber();
+      if (step < 0) {
+        number = std::ceil(number);
       } else {
-        auto field = getmetafield(self, "__le");
-        if (field.is_nil()) {
-          field = getmetafield(that, "__le");
-        }
-        if (!field.is_nil()) {
-          return call1(field, { self, that }).toboolean();
-        }
-        field = getmetafield(that, "__lt");
-        if (field.is_nil()) {
-          field = getmetafield(self, "__lt");
-        }
-        if (!field.is_nil()) {
-          return !call1(field, { that, self }).toboolean();
-        }
+        number = std::floor(number);
+      }
+      if (number >= 9223372036854775808.0) {
+        return std::numeric_limits<std::int64_t>::max();
+      } else if (number >= -9223372036854775808.0) {
+        return number;
+      } else if (number < 0 || step >= 0) {
+        return std::numeric_limits<std::int64_t>::min();
+      } else {
+        // nan. the loop does not run.
+        return std::numeric_limits<std::int64_t>::max();
+      }
+    }
+
+    bool compare(compare_t op, const value_t& self, const value_t& that) {
+      switch (op) {
+        case compare_t::eq:
+          if (rawequal(self, that)) {
+            return true;
+          }
+          if (self.is_table() && that.is_table()) {
+            auto field = getmetafield(self, event_t::eq);
+            if (field.is_nil()) {
+              field = getmetafield(that, event_t::eq);
+            }
+            if (!field.is_nil()) {
+              return call1(field, { self, that }).toboolean();
+            }
+          }
+          return false;
+        case compare_t::lt:
+          if (self.is_number() && that.is_number()) {
+            return lt_number(self, that);
+          } else if (self.is_string() && that.is_string()) {
+            return string_lt(*self.string, *that.string);
+          } else {
+            auto field = getmetafield(self, event_t::lt);
+            if (field.is_nil()) {
+              field = getmetafield(that, event_t::lt);
+            }
+            if (!field.is_nil()) {
+              return call1(field, { self, that }).toboolean();
+            }
+          }
+          break;
+        case compare_t::le:
+          if (self.is_number() && that.is_number()) {
+            return le_number(self, that);
+          } else if (self.is_string() && that.is_string()) {
+            return !string_lt(*that.string, *self.string);
+          } else {
+            auto field = getmetafield(self, event_t::le);
+            if (field.is_nil()) {
+              field = getmetafield(that, event_t::le);
+            }
+            if (!field.is_nil()) {
+              return call1(field, { self, that }).toboolean();
+            }
+            field = getmetafield(that, event_t::lt);
+            if (field.is_nil()) {
+              field = getmetafield(self, event_t::lt);
+            }
+            if (!field.is_nil()) {
+              return !call1(field, { that, self }).toboolean();
+            }
+          }
+          break;
       }
       throw value_t("attempt to compare " + type(self) + " with " + type(that));
     }
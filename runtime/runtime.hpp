@@ -23,15 +23,30 @@
 #ifndef DROMOZOA_COMPILER_RUNTIME_CXX_VALUE_HPP
 #define DROMOZOA_COMPILER_RUNTIME_CXX_VALUE_HPP
 
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <initializer_list>
-#include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+// strings up to this length are interned. define it to SIZE_MAX to intern
+// all strings.
+#ifndef DROMOZOA_COMPILER_RUNTIME_SHORT_STRING_MAX
+#define DROMOZOA_COMPILER_RUNTIME_SHORT_STRING_MAX 40
+#endif
+
+// substrings of at least this length share the buffer of their string.
+#ifndef DROMOZOA_COMPILER_RUNTIME_SLICE_MIN
+#define DROMOZOA_COMPILER_RUNTIME_SLICE_MIN 256
+#endif
 
 namespace dromozoa {
   namespace runtime {
@@ -43,20 +58,175 @@ namespace dromozoa {
       constant,
     };
 
+    // number is a float. integer is the integer subtype of number, as in Lua
+    // 5.3; type() reports both as number.
     enum struct type_t : std::uint8_t {
       nil,
       boolean,
+      integer,
       number,
       string,
       table,
       function,
     };
 
-    using string_ptr = std::shared_ptr<std::string>;
+    struct container_t;
+
+    // reference counting frees everything but cycles. containers (tables,
+    // functions and the blocks behind register and upvalue arrays) are linked
+    // into a list and scanned by a trial deletion cycle collector.
+    struct gc_t {
+      // bytes held by runtime objects.
+      std::size_t bytes;
+      // a collection starts when a container is created above this.
+      std::size_t threshold;
+      // the threshold is set to pause percent of the bytes in use after a
+      // collection, as in Lua.
+      int pause;
+      // kept for collectgarbage("setstepmul"). the collector is not
+      // incremental, so each step runs a whole cycle.
+      int stepmul;
+      bool running;
+      bool collecting;
+      container_t* head;
+    };
+
+    extern gc_t gc;
+
+    std::size_t collect();
+
+    // strings, tables and functions carry their own reference count. the
+    // runtime is single-threaded, so the count is not atomic.
+    struct object_t {
+      object_t() : count() {}
+      object_t(const object_t&) : count() {}
+      object_t& operator=(const object_t&) { return *this; }
+
+      static void* operator new(std::size_t size) {
+        gc.bytes += size;
+        return ::operator new(size);
+      }
+
+      static void operator delete(void* ptr, std::size_t size) {
+        gc.bytes -= size;
+        ::operator delete(ptr);
+      }
+
+      std::size_t count;
+    };
+
+    template <class T>
+    struct ptr_t {
+      ptr_t() : ptr() {}
+
+      ptr_t(std::nullptr_t) : ptr() {}
+
+      explicit ptr_t(T* ptr) : ptr(ptr) {
+        retain();
+      }
+
+      ptr_t(const ptr_t& that) : ptr(that.ptr) {
+        retain();
+      }
+
+      ptr_t(ptr_t&& that) : ptr(that.ptr) {
+        that.ptr = nullptr;
+      }
+
+      template <class U, class = enable_if_t<std::is_convertible<U*, T*>::value>>
+      ptr_t(const ptr_t<U>& that) : ptr(that.ptr) {
+        retain();
+      }
+
+      template <class U, class = enable_if_t<std::is_convertible<U*, T*>::value>>
+      ptr_t(ptr_t<U>&& that) : ptr(that.ptr) {
+        that.ptr = nullptr;
+      }
+
+      ~ptr_t() {
+        release();
+      }
+
+      ptr_t& operator=(ptr_t that) {
+        std::swap(ptr, that.ptr);
+        return *this;
+      }
+
+      T* get() const {
+        return ptr;
+      }
+
+      T& operator*() const {
+        return *ptr;
+      }
+
+      T* operator->() const {
+        return ptr;
+      }
+
+      explicit operator bool() const {
+        return ptr;
+      }
+
+      void retain() {
+        if (ptr) {
+          ++ptr->count;
+        }
+      }
+
+      void release() {
+        if (ptr && --ptr->count == 0) {
+          delete ptr;
+        }
+      }
+
+      T* ptr;
+    };
+
+    template <class T, class U>
+    inline bool operator==(const ptr_t<T>& a, const ptr_t<U>& b) {
+      return a.get() == b.get();
+    }
+
+    template <class T, class U>
+    inline bool operator!=(const ptr_t<T>& a, const ptr_t<U>& b) {
+      return a.get() != b.get();
+    }
+
+    template <class T, class U>
+    inline bool operator<(const ptr_t<T>& a, const ptr_t<U>& b) {
+      return a.get() < b.get();
+    }
+
+    template <class T, class... T_args>
+    inline ptr_t<T> make_ptr(T_args&&... args) {
+      return ptr_t<T>(new T(std::forward<T_args>(args)...));
+    }
+
+    struct visitor_t;
+
+    struct container_t : object_t {
+      container_t();
+      container_t(const container_t&);
+      virtual ~container_t();
+      container_t& operator=(const container_t&) { return *this; }
+      // visits the containers referenced from this.
+      virtual void traverse(visitor_t&) {}
+      // drops the references to break a garbage cycle.
+      virtual void clear() {}
+
+      container_t* prev;
+      container_t* next;
+      std::size_t refs;
+      bool marked;
+    };
+
+    struct string_t;
+    using string_ptr = ptr_t<string_t>;
     struct table_t;
-    using table_ptr = std::shared_ptr<table_t>;
+    using table_ptr = ptr_t<table_t>;
     struct function_t;
-    using function_ptr = std::shared_ptr<function_t>;
+    using function_ptr = ptr_t<function_t>;
 
     struct value_t {
       value_t();
@@ -68,16 +238,18 @@ namespace dromozoa {
 
       value_t(type_t);
       value_t(bool);
+      value_t(std::int64_t);
       value_t(double);
       value_t(const char*);
       value_t(const char*, size_t);
       value_t(const std::string&);
       value_t(std::string&&);
+      value_t(string_ptr);
       value_t(function_ptr);
 
       template <class T>
       value_t(T value, enable_if_t<std::is_integral<T>::value>* = 0)
-        : value_t(static_cast<double>(value)) {}
+        : value_t(static_cast<std::int64_t>(value)) {}
 
       template <class T>
       value_t(T value, enable_if_t<std::is_convertible<T, function_ptr>::value>* = 0)
@@ -90,23 +262,36 @@ namespace dromozoa {
 
       bool is_nil() const;
       bool is_boolean() const;
+      bool is_integer() const;
+      bool is_float() const;
       bool is_number() const;
       bool is_string() const;
       bool is_table() const;
       bool is_function() const;
 
       bool toboolean() const;
+      // the number as a float. this must be a number.
+      double tofloat() const;
       bool tonumber(double& result) const;
       double checknumber() const;
       std::int64_t checkinteger() const;
       std::string checkstring() const;
+      // the string borrowed, or the number converted to a new string.
+      string_ptr checkstring_ptr() const;
       table_ptr checktable() const;
       std::int64_t optinteger(std::int64_t) const;
 
+      void copy_construct(const value_t&);
+      void move_construct(value_t&&);
+      void destruct();
+      void copy_assign(const value_t&);
+      void move_assign(value_t&&);
+
       const mode_t mode;
       type_t type;
       union {
         bool boolean;
+        std::int64_t integer;
         double number;
         string_ptr string;
         table_ptr table;
@@ -120,26 +305,106 @@ namespace dromozoa {
     extern value_t string_metatable;
     extern value_t env;
 
+    // not inlined. gcc takes a free inlined into ptr_t::release for a use
+    // after free when two handles share a block.
+    void deallocate(void*);
+
+    // a container with the elements stored after the header in the same
+    // allocation.
+    template <class T>
+    struct block_t : container_t {
+      static block_t* create(std::size_t size) {
+        void* ptr = ::operator new(sizeof(block_t) + sizeof(T) * size);
+        try {
+          return ::new(ptr) block_t(size);
+        } catch (...) {
+          ::operator delete(ptr);
+          throw;
+        }
+      }
+
+      static void operator delete(void* ptr) {
+        deallocate(ptr);
+      }
+
+      explicit block_t(std::size_t size) : size() {
+        for (; this->size < size; ++this->size) {
+          new (data() + this->size) T();
+        }
+        gc.bytes += sizeof(block_t) + sizeof(T) * size;
+      }
+
+      ~block_t() {
+        gc.bytes -= sizeof(block_t) + sizeof(T) * size;
+        for (std::size_t i = size; i > 0; --i) {
+          data()[i - 1].~T();
+        }
+      }
+
+      T* data() {
+        return reinterpret_cast<T*>(this + 1);
+      }
+
+      virtual void traverse(visitor_t&);
+
+      virtual void clear() {
+        for (std::size_t i = 0; i < size; ++i) {
+          data()[i].~T();
+          new (data() + i) T();
+        }
+      }
+
+      std::size_t size;
+    };
+
+    // the arguments and the results of a call. a few values are stored in
+    // place, so that most calls do not allocate. more values are stored in a
+    // block that the copies share, so write only to an array that is not
+    // copied yet.
     struct array_t {
+      static constexpr std::size_t inline_size = 3;
+
       array_t();
-      array_t(std::size_t);
+      explicit array_t(std::size_t);
       array_t(std::initializer_list<value_t>);
-      array_t(std::initializer_list<value_t>, array_t);
-      array_t(const value_t&, array_t);
-      value_t& operator[](std::size_t) const;
+      array_t(std::initializer_list<value_t>, const array_t&);
+      array_t(std::initializer_list<value_t>, array_t&&);
+      array_t(const value_t&, const array_t&);
+      array_t(const value_t&, array_t&&);
+      array_t(const array_t&);
+      array_t(array_t&&);
+      array_t& operator=(const array_t&);
+      array_t& operator=(array_t&&);
+      const value_t& operator[](std::size_t) const;
+      value_t& operator[](std::size_t);
+      const value_t* data() const;
+      // the values can be moved from unless the block is shared.
+      bool owns() const;
       array_t sub(std::size_t) const;
       array_t sub(std::size_t, std::size_t) const;
 
-      std::shared_ptr<value_t> data;
+      ptr_t<block_t<value_t>> block;
+      std::size_t size;
+      value_t values[inline_size];
+    };
+
+    // the registers that closures capture. copies share the values.
+    struct registers_t {
+      registers_t();
+      explicit registers_t(std::size_t);
+      registers_t(std::initializer_list<value_t>);
+      value_t& operator[](std::size_t) const;
+
+      ptr_t<block_t<value_t>> block;
       std::size_t size;
     };
 
     struct upvalue_t {
       upvalue_t();
-      upvalue_t(array_t array, std::size_t index);
+      upvalue_t(registers_t registers, std::size_t index);
       value_t& operator*() const;
 
-      array_t array;
+      registers_t registers;
       std::size_t index;
     };
 
@@ -148,31 +413,188 @@ namespace dromozoa {
       uparray_t(std::initializer_list<upvalue_t>);
       upvalue_t& operator[](std::size_t) const;
 
-      std::shared_ptr<upvalue_t> data;
+      ptr_t<block_t<upvalue_t>> block;
+      std::size_t size;
+    };
+
+    struct visitor_t {
+      virtual ~visitor_t() {}
+      virtual void operator()(container_t*) = 0;
+
+      void operator()(const value_t&);
+
+      void operator()(const registers_t& registers) {
+        if (registers.block) {
+          (*this)(registers.block.get());
+        }
+      }
+
+      void operator()(const upvalue_t& upvalue) {
+        (*this)(upvalue.registers);
+      }
+
+      void operator()(const uparray_t& uparray) {
+        if (uparray.block) {
+          (*this)(uparray.block.get());
+        }
+      }
+    };
+
+    template <class T>
+    inline void block_t<T>::traverse(visitor_t& visit) {
+      for (std::size_t i = 0; i < size; ++i) {
+        visit(data()[i]);
+      }
+    }
+
+    // counts the bytes held by the parts of a table.
+    template <class T>
+    struct allocator_t {
+      using value_type = T;
+
+      allocator_t() {}
+
+      template <class U>
+      allocator_t(const allocator_t<U>&) {}
+
+      T* allocate(std::size_t n) {
+        gc.bytes += sizeof(T) * n;
+        return static_cast<T*>(::operator new(sizeof(T) * n));
+      }
+
+      void deallocate(T* ptr, std::size_t n) {
+        gc.bytes -= sizeof(T) * n;
+        ::operator delete(ptr);
+      }
+    };
+
+    template <class T, class U>
+    inline bool operator==(const allocator_t<T>&, const allocator_t<U>&) {
+      return true;
+    }
+
+    template <class T, class U>
+    inline bool operator!=(const allocator_t<T>&, const allocator_t<U>&) {
+      return false;
+    }
+
+    // the strings are not changed once made. data and size refer to the
+    // buffer, or to a part of the buffer of the parent for a slice. the hashes
+    // of the slices are computed when they are first needed.
+    struct string_t : object_t {
+      string_t(std::string&&, std::size_t);
+      string_t(ptr_t<string_t>, std::size_t, std::size_t);
+      ~string_t();
+
+      std::string buffer;
+      ptr_t<string_t> parent;
+      const char* data;
       std::size_t size;
+      std::size_t hash;
+      bool hashed;
+      bool interned;
+    };
+
+    struct node_t {
+      value_t key;
+      value_t value;
+      std::size_t hash;
     };
 
-    struct table_t {
+    // the set of the string keys of a table used as a record. the tables that
+    // are given the same keys in the same order share a shape, and keep the
+    // values in their slots in that order. a shape is never changed; adding a
+    // key moves the table to a child shape.
+    struct shape_t : object_t {
+      static constexpr std::size_t max_size = 16;
+
+      shape_t();
+      shape_t(ptr_t<shape_t>, const value_t&);
+      ~shape_t();
+
+      // the index of the key, or the size if the key is absent. the keys are
+      // short strings, which are interned, so they are compared by identity.
+      std::size_t find(const string_t* key) const {
+        const auto n = keys.size();
+        for (std::size_t i = 0; i < n; ++i) {
+          if (keys[i].string.get() == key) {
+            return i;
+          }
+        }
+        return n;
+      }
+
+      ptr_t<shape_t> parent;
+      std::vector<value_t> keys;
+      // the children are not owned. a child removes itself when destructed.
+      std::vector<shape_t*> children;
+      // the largest size of the shapes reached from this, to reserve slots.
+      std::size_t expected;
+    };
+
+    struct table_t : container_t {
+      table_t();
       const value_t& get(const value_t&) const;
       void set(const value_t&, const value_t&);
+      std::int64_t len() const;
+      virtual void traverse(visitor_t&);
+      virtual void clear();
 
-      std::map<value_t, value_t> map;
+      std::vector<value_t, allocator_t<value_t>> array;
+      std::vector<node_t, allocator_t<node_t>> node;
+      std::size_t node_size;
+      // the short string keys are kept in the slots of the shape, until
+      // there are too many of them. then the table becomes dynamic, and all
+      // the string keys are kept in the node part. a slot is nil if the key
+      // is removed.
+      ptr_t<shape_t> shape;
+      std::vector<value_t, allocator_t<value_t>> slots;
+      bool dynamic;
       value_t metatable;
+      // a bit is set if the metamethod is known to be absent when this table
+      // is used as a metatable. cleared whenever the table is written to.
+      std::uint16_t flags;
     };
 
-    struct function_t {
-      virtual ~function_t() {}
-      virtual array_t operator()(array_t) = 0;
+    // an inline cache of a field access with a constant string key. it holds
+    // the shape and the slot where the key was found last time, or the slot
+    // of the node part if the shape is null. the slot of a shape is valid for
+    // all the tables of the shape, and the slot of the node part is valid as
+    // long as it still holds the key. the shape is owned so that its address
+    // is not reused.
+    struct cache_t {
+      ptr_t<shape_t> shape;
+      std::size_t index;
+    };
+
+    struct function_t : container_t {
+      virtual array_t operator()(const array_t&) = 0;
     };
 
-    template <std::size_t T>
     struct proto_t : function_t {
-      virtual array_t operator()(array_t, array_t) const = 0;
-      virtual array_t operator()(array_t args) {
-        return (*this)(args.sub(0, T), args.sub(T));
+      explicit proto_t(uparray_t U) : U(U) {}
+
+      virtual void traverse(visitor_t& visit) {
+        visit(U);
       }
+
+      virtual void clear() {
+        U = uparray_t();
+      }
+
+      uparray_t U;
     };
 
+    inline void visitor_t::operator()(const value_t& value) {
+      if (value.is_table()) {
+        (*this)(value.table.get());
+      } else if (value.is_function()) {
+        (*this)(value.function.get());
+      }
+    }
+
+    value_t intern(const char*, std::size_t);
+
     const value_t& rawget(const value_t&, const value_t&);
     const value_t& rawset(const value_t&, const value_t&, const value_t&);
     const value_t& getmetafield(const value_t&, const value_t&);
@@ -180,17 +602,75 @@ namespace dromozoa {
     const value_t& setmetatable(const value_t&, const value_t&);
     value_t gettable(const value_t&, const value_t&);
     void settable(const value_t&, const value_t&, const value_t&);
+    // the field accesses with constant string keys try the slot in the cache
+    // inline, and go through the out-of-line functions on a miss.
+    value_t getfield(const value_t&, const value_t&, cache_t&);
+    void setfield(const value_t&, const value_t&, const value_t&, cache_t&);
+    value_t getfield_miss(const value_t&, const value_t&, cache_t&);
+    void setfield_miss(const value_t&, const value_t&, const value_t&, cache_t&);
     void setlist(const value_t&, std::size_t, const value_t&);
     void setlist(const value_t&, std::size_t, const array_t&);
 
     array_t call(const value_t&, const array_t& args);
     value_t call1(const value_t&, const array_t& args);
     void call0(const value_t&, const array_t& args);
+    // the first of the results, which is moved unless they are shared.
+    value_t first(array_t&&);
 
     std::string type(const value_t&);
     std::string tostring(const value_t&);
     std::int64_t len(const value_t&);
     bool rawequal(const value_t&, const value_t&);
+
+    // the operands of a chain of concatenations are joined into a string that
+    // is sized once.
+    value_t concat(std::initializer_list<const value_t*>);
+
+    template <class... T>
+    inline value_t concat(const T&... operands) {
+      return concat({ &operands... });
+    }
+
+    // arithmetic and comparison on numbers are done inline. anything else
+    // (coercion, strings, metamethods, division by zero) goes through the
+    // out-of-line functions below.
+    enum struct arith_t : std::uint8_t {
+      add, sub, mul, mod, pow, div, idiv, unm,
+      band, bor, bxor, shl, shr, bnot,
+    };
+    enum struct compare_t : std::uint8_t { eq, lt, le };
+
+    value_t arith(arith_t, const value_t&, const value_t&);
+    bool compare(compare_t, const value_t&, const value_t&);
+    value_t tonumber(const value_t&);
+    // the limit of an integer numeric for, converted as in Lua 5.3.
+    std::int64_t forlimit(const value_t& limit, std::int64_t step);
+
+    // integers wrap around, as in Lua.
+    std::int64_t add(std::int64_t, std::int64_t);
+    std::int64_t sub(std::int64_t, std::int64_t);
+    std::int64_t mul(std::int64_t, std::int64_t);
+    std::int64_t mod(std::int64_t, std::int64_t);
+    std::int64_t idiv(std::int64_t, std::int64_t);
+    std::int64_t unm(std::int64_t);
+    std::int64_t shl(std::int64_t, std::int64_t);
+    std::int64_t shr(std::int64_t, std::int64_t);
+    double mod(double, double);
+
+    value_t add(const value_t&, const value_t&);
+    value_t sub(const value_t&, const value_t&);
+    value_t mul(const value_t&, const value_t&);
+    value_t mod(const value_t&, const value_t&);
+    double pow(const value_t&, const value_t&);
+    double div(const value_t&, const value_t&);
+    value_t idiv(const value_t&, const value_t&);
+    value_t unm(const value_t&);
+    std::int64_t band(const value_t&, const value_t&);
+    std::int64_t bor(const value_t&, const value_t&);
+    std::int64_t bxor(const value_t&, const value_t&);
+    std::int64_t shl(const value_t&, const value_t&);
+    std::int64_t shr(const value_t&, const value_t&);
+    std::int64_t bnot(const value_t&);
     bool eq(const value_t&, const value_t&);
     bool lt(const value_t&, const value_t&);
     bool le(const value_t&, const value_t&);
@@ -327,17 +807,475 @@ namespace dromozoa {
     template <class T>
     struct closure_t : function_t {
       closure_t(T function) : function(function) {}
-      virtual array_t operator()(array_t args) {
+      virtual array_t operator()(const array_t& args) {
         return invoke(function, args);
       }
       T function;
     };
 
+    // nil, boolean and number are copied without touching the heap. the other
+    // types go through the out-of-line functions.
+    inline value_t::value_t()
+      : mode(mode_t::variable),
+        type(type_t::nil) {}
+
+    inline value_t::value_t(const value_t& that)
+      : mode(mode_t::variable),
+        type(that.type) {
+      if (type < type_t::string) {
+        std::memcpy(&number, &that.number, sizeof(number));
+      } else {
+        copy_construct(that);
+      }
+    }
+
+    inline value_t::value_t(value_t&& that)
+      : mode(mode_t::variable),
+        type(that.type) {
+      if (type < type_t::string) {
+        std::memcpy(&number, &that.number, sizeof(number));
+      } else {
+        move_construct(std::move(that));
+      }
+    }
+
+    inline value_t::~value_t() {
+      if (type >= type_t::string) {
+        destruct();
+      }
+    }
+
+    inline value_t& value_t::operator=(const value_t& that) {
+      if (mode == mode_t::constant) {
+        throw std::logic_error("cannot assign to constant value");
+      }
+      if (type < type_t::string && that.type < type_t::string) {
+        type = that.type;
+        std::memcpy(&number, &that.number, sizeof(number));
+      } else {
+        copy_assign(that);
+      }
+      return *this;
+    }
+
+    inline value_t& value_t::operator=(value_t&& that) {
+      if (mode == mode_t::constant) {
+        throw std::logic_error("cannot assign to constant value");
+      }
+      if (type < type_t::string && that.type < type_t::string) {
+        type = that.type;
+        std::memcpy(&number, &that.number, sizeof(number));
+      } else {
+        move_assign(std::move(that));
+      }
+      return *this;
+    }
+
+    inline value_t::value_t(bool boolean)
+      : mode(mode_t::constant),
+        type(type_t::boolean) {
+      this->boolean = boolean;
+    }
+
+    inline value_t::value_t(std::int64_t integer)
+      : mode(mode_t::constant),
+        type(type_t::integer) {
+      this->integer = integer;
+    }
+
+    inline value_t::value_t(double number)
+      : mode(mode_t::constant),
+        type(type_t::number) {
+      this->number = number;
+    }
+
+    inline bool value_t::is_nil() const {
+      return type == type_t::nil;
+    }
+
+    inline bool value_t::is_boolean() const {
+      return type == type_t::boolean;
+    }
+
+    inline bool value_t::is_integer() const {
+      return type == type_t::integer;
+    }
+
+    inline bool value_t::is_float() const {
+      return type == type_t::number;
+    }
+
+    inline bool value_t::is_number() const {
+      return type == type_t::integer || type == type_t::number;
+    }
+
+    inline bool value_t::is_string() const {
+      return type == type_t::string;
+    }
+
+    inline bool value_t::is_table() const {
+      return type == type_t::table;
+    }
+
+    inline bool value_t::is_function() const {
+      return type == type_t::function;
+    }
+
+    inline bool value_t::toboolean() const {
+      if (is_nil()) {
+        return false;
+      } else if (is_boolean()) {
+        return boolean;
+      }
+      return true;
+    }
+
+    inline double value_t::tofloat() const {
+      if (is_integer()) {
+        return integer;
+      }
+      return number;
+    }
+
+    inline array_t::array_t()
+      : size() {}
+
+    inline array_t::array_t(std::initializer_list<value_t> source)
+      : size(source.size()) {
+      value_t* ptr = values;
+      if (size > inline_size) {
+        block = ptr_t<block_t<value_t>>(block_t<value_t>::create(size));
+        ptr = block->data();
+      }
+      for (const auto& value : source) {
+        *ptr++ = value;
+      }
+    }
+
+    inline array_t::array_t(const array_t& that)
+      : block(that.block),
+        size(that.size) {
+      if (!block) {
+        for (std::size_t i = 0; i < size; ++i) {
+          values[i] = that.values[i];
+        }
+      }
+    }
+
+    inline array_t::array_t(array_t&& that)
+      : block(std::move(that.block)),
+        size(that.size) {
+      if (!block) {
+        for (std::size_t i = 0; i < size; ++i) {
+          values[i] = std::move(that.values[i]);
+        }
+      }
+      that.size = 0;
+    }
+
+    inline array_t& array_t::operator=(const array_t& that) {
+      if (this != &that) {
+        block = that.block;
+        const std::size_t n = block ? 0 : that.size;
+        for (std::size_t i = 0; i < inline_size; ++i) {
+          values[i] = i < n ? that.values[i] : NIL;
+        }
+        size = that.size;
+      }
+      return *this;
+    }
+
+    inline array_t& array_t::operator=(array_t&& that) {
+      if (this != &that) {
+        block = std::move(that.block);
+        const std::size_t n = block ? 0 : that.size;
+        for (std::size_t i = 0; i < inline_size; ++i) {
+          if (i < n) {
+            values[i] = std::move(that.values[i]);
+          } else {
+            values[i] = NIL;
+          }
+        }
+        size = that.size;
+        that.size = 0;
+      }
+      return *this;
+    }
+
+    inline const value_t& array_t::operator[](std::size_t i) const {
+      if (i < size) {
+        return data()[i];
+      } else {
+        return NIL;
+      }
+    }
+
+    inline value_t& array_t::operator[](std::size_t i) {
+      if (i < size) {
+        return block ? block->data()[i] : values[i];
+      } else {
+        return NIL;
+      }
+    }
+
+    inline const value_t* array_t::data() const {
+      return block ? block->data() : values;
+    }
+
+    inline bool array_t::owns() const {
+      return !block || block->count == 1;
+    }
+
     template <class T>
     inline value_t::value_t(T function, enable_if_t<(!std::is_integral<T>::value && !std::is_convertible<T, function_ptr>::value)>*)
       : mode(mode_t::constant),
         type(type_t::function) {
-      new (&this->function) function_ptr(std::make_shared<closure_t<T>>(function));
+      new (&this->function) function_ptr(make_ptr<closure_t<T>>(function));
+    }
+
+    inline std::int64_t add(std::int64_t x, std::int64_t y) {
+      return static_cast<std::uint64_t>(x) + static_cast<std::uint64_t>(y);
+    }
+
+    inline std::int64_t sub(std::int64_t x, std::int64_t y) {
+      return static_cast<std::uint64_t>(x) - static_cast<std::uint64_t>(y);
+    }
+
+    inline std::int64_t mul(std::int64_t x, std::int64_t y) {
+      return static_cast<std::uint64_t>(x) * static_cast<std::uint64_t>(y);
+    }
+
+    // rounds towards minus infinity. the divisors 0 and -1 take the slow path.
+    inline std::int64_t mod(std::int64_t x, std::int64_t y) {
+      if (y > 0) {
+        const auto r = x % y;
+        return r < 0 ? r + y : r;
+      }
+      return arith(arith_t::mod, x, y).integer;
+    }
+
+    inline std::int64_t idiv(std::int64_t x, std::int64_t y) {
+      if (y > 0) {
+        const auto q = x / y;
+        return x % y < 0 ? q - 1 : q;
+      }
+      return arith(arith_t::idiv, x, y).integer;
+    }
+
+    inline std::int64_t unm(std::int64_t x) {
+      return 0 - static_cast<std::uint64_t>(x);
+    }
+
+    // shifts by 64 bits or more give zero. negative counts shift the other
+    // way.
+    inline std::int64_t shl(std::int64_t x, std::int64_t y) {
+      if (y < 0) {
+        if (y <= -64) {
+          return 0;
+        }
+        return static_cast<std::uint64_t>(x) >> -y;
+      } else {
+        if (y >= 64) {
+          return 0;
+        }
+        return static_cast<std::uint64_t>(x) << y;
+      }
+    }
+
+    inline std::int64_t shr(std::int64_t x, std::int64_t y) {
+      return shl(x, unm(y));
+    }
+
+    // the remainder has the sign of the divisor.
+    inline double mod(double x, double y) {
+      const auto r = std::fmod(x, y);
+      if (r > 0 ? y < 0 : (r < 0 && y != r)) {
+        return r + y;
+      }
+      return r;
+    }
+
+    inline value_t add(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return add(self.integer, that.integer);
+      } else if (self.is_number() && that.is_number()) {
+        return self.tofloat() + that.tofloat();
+      }
+      return arith(arith_t::add, self, that);
+    }
+
+    inline value_t sub(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return sub(self.integer, that.integer);
+      } else if (self.is_number() && that.is_number()) {
+        return self.tofloat() - that.tofloat();
+      }
+      return arith(arith_t::sub, self, that);
+    }
+
+    inline value_t mul(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return mul(self.integer, that.integer);
+      } else if (self.is_number() && that.is_number()) {
+        return self.tofloat() * that.tofloat();
+      }
+      return arith(arith_t::mul, self, that);
+    }
+
+    inline value_t mod(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return mod(self.integer, that.integer);
+      } else if (self.is_number() && that.is_number()) {
+        return mod(self.tofloat(), that.tofloat());
+      }
+      return arith(arith_t::mod, self, that);
+    }
+
+    inline double pow(const value_t& self, const value_t& that) {
+      if (self.is_number() && that.is_number()) {
+        return std::pow(self.tofloat(), that.tofloat());
+      }
+      return arith(arith_t::pow, self, that).number;
+    }
+
+    inline double div(const value_t& self, const value_t& that) {
+      if (self.is_number() && that.is_number()) {
+        return self.tofloat() / that.tofloat();
+      }
+      return arith(arith_t::div, self, that).number;
+    }
+
+    inline value_t idiv(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return idiv(self.integer, that.integer);
+      } else if (self.is_number() && that.is_number()) {
+        return std::floor(self.tofloat() / that.tofloat());
+      }
+      return arith(arith_t::idiv, self, that);
+    }
+
+    inline value_t unm(const value_t& self) {
+      if (self.is_integer()) {
+        return unm(self.integer);
+      } else if (self.is_float()) {
+        return -self.number;
+      }
+      return arith(arith_t::unm, self, self);
+    }
+
+    inline std::int64_t band(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return self.integer & that.integer;
+      }
+      return arith(arith_t::band, self, that).integer;
+    }
+
+    inline std::int64_t bor(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return self.integer | that.integer;
+      }
+      return arith(arith_t::bor, self, that).integer;
+    }
+
+    inline std::int64_t bxor(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return self.integer ^ that.integer;
+      }
+      return arith(arith_t::bxor, self, that).integer;
+    }
+
+    inline std::int64_t shl(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return shl(self.integer, that.integer);
+      }
+      return arith(arith_t::shl, self, that).integer;
+    }
+
+    inline std::int64_t shr(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return shr(self.integer, that.integer);
+      }
+      return arith(arith_t::shr, self, that).integer;
+    }
+
+    inline std::int64_t bnot(const value_t& self) {
+      if (self.is_integer()) {
+        return ~self.integer;
+      }
+      return arith(arith_t::bnot, self, self).integer;
+    }
+
+    inline bool eq(const value_t& self, const value_t& that) {
+      if (self.type == that.type) {
+        if (self.is_integer()) {
+          return self.integer == that.integer;
+        } else if (self.is_float()) {
+          return self.number == that.number;
+        }
+      } else if (!self.is_number() || !that.is_number()) {
+        return false;
+      }
+      return compare(compare_t::eq, self, that);
+    }
+
+    inline bool lt(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return self.integer < that.integer;
+      } else if (self.is_float() && that.is_float()) {
+        return self.number < that.number;
+      }
+      return compare(compare_t::lt, self, that);
+    }
+
+    inline bool le(const value_t& self, const value_t& that) {
+      if (self.is_integer() && that.is_integer()) {
+        return self.integer <= that.integer;
+      } else if (self.is_float() && that.is_float()) {
+        return self.number <= that.number;
+      }
+      return compare(compare_t::le, self, that);
+    }
+
+    // the keys are compared by identity, since the short strings are
+    // interned. a present key has a value that is not nil.
+    inline value_t getfield(const value_t& table, const value_t& key, cache_t& cache) {
+      if (table.is_table()) {
+        const auto& self = *table.table;
+        const auto i = cache.index;
+        if (cache.shape) {
+          if (self.shape == cache.shape && !self.slots[i].is_nil()) {
+            return self.slots[i];
+          }
+        } else {
+          const auto& node = self.node;
+          if (i < node.size() && node[i].key.is_string() && node[i].key.string == key.string) {
+            return node[i].value;
+          }
+        }
+      }
+      return getfield_miss(table, key, cache);
+    }
+
+    inline void setfield(const value_t& table, const value_t& key, const value_t& value, cache_t& cache) {
+      if (table.is_table() && !value.is_nil()) {
+        auto& self = *table.table;
+        const auto i = cache.index;
+        if (cache.shape) {
+          if (self.shape == cache.shape && !self.slots[i].is_nil()) {
+            self.slots[i] = value;
+            self.flags = 0;
+            return;
+          }
+        } else {
+          auto& node = self.node;
+          if (i < node.size() && node[i].key.is_string() && node[i].key.string == key.string) {
+            node[i].value = value;
+            self.flags = 0;
+            return;
+          }
+        }
+      }
+      setfield_miss(table, key, value, cache);
     }
   }
 }
@@ -206,6 +206,7 @@ const toboolean = (v) => {
 
 const decint_pattern = /^\s*([+-]?\d+)\s*$/;
 const hexint_pattern = /^\s*([+-]?0[xX][0-9A-Fa-f]+)\s*$/;
+const hexflt_pattern = /^\s*([+-]?)0[xX]([0-9A-Fa-f]*)(?:\.([0-9A-Fa-f]*))?(?:[pP]([+-]?\d+))?\s*$/;
 const decflt_pattern = /^\s*([+-]?(?:\d+(?:\.\d*)?|\.\d+)(?:[eE][+-]?\d+)?)\s*$/;
 
 const tonumber = v => {
@@ -222,6 +223,15 @@ const tonumber = v => {
     if ((match = decflt_pattern.exec(unwrap(v)))) {
       return parseFloat(match[0]);
     }
+    if ((match = hexflt_pattern.exec(unwrap(v)))) {
+      const digits = match[2] + (match[3] || "");
+      if (digits.length > 0) {
+        const e = (match[4] || 0) - 4 * (match[3] || "").length;
+        const h = Math.trunc(e / 2);
+        const result = parseInt(digits, 16) * Math.pow(2, h) * Math.pow(2, e - h);
+        return match[1] === "-" ? -result : result;
+      }
+    }
   }
 };
 
@@ -606,6 +616,41 @@ const open_base = env => {
     }
   });
 
+  // the host collects the garbage. only the parameters are kept.
+  const gc = { pause: 200, stepmul: 200, running: true };
+
+  settable(env, "collectgarbage", (opt, arg) => {
+    const option = opt === undefined ? "collect" : checkstring(opt).string;
+    if (option === "collect") {
+      return 0;
+    } else if (option === "count") {
+      if (typeof process !== "undefined") {
+        return process.memoryUsage().heapUsed / 1024;
+      }
+      return 0;
+    } else if (option === "step") {
+      return true;
+    } else if (option === "isrunning") {
+      return gc.running;
+    } else if (option === "stop") {
+      gc.running = false;
+      return 0;
+    } else if (option === "restart") {
+      gc.running = true;
+      return 0;
+    } else if (option === "setpause") {
+      const pause = gc.pause;
+      gc.pause = arg === undefined ? 0 : checkinteger(arg);
+      return pause;
+    } else if (option === "setstepmul") {
+      const stepmul = gc.stepmul;
+      gc.stepmul = arg === undefined ? 0 : checkinteger(arg);
+      return stepmul;
+    } else {
+      throw new runtime_error(concat("bad argument #1 to 'collectgarbage' (invalid option '", option, "')"));
+    }
+  });
+
   settable(env, "error", message => {
     throw new runtime_error(message);
   });
@@ -0,0 +1,90 @@
+// Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+//
+// This file is part of dromozoa-compiler.
+//
+// dromozoa-compiler is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dromozoa-compiler is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+//
+// You should have received a copy of the GNU General Public License
+// and a copy of the GCC Runtime Library Exception along with
+// dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "allocations.hpp"
+#include "runtime.hpp"
+
+namespace dromozoa {
+  namespace runtime {
+    // a function in the shape that compile_cxx emits.
+    struct add_program {
+      value_t A[2];
+      value_t C[1];
+      array_t T;
+
+      add_program(const array_t& args)
+        : A { args[0], args[1] } {}
+
+      array_t entry() {
+        C[0] = A[0].checknumber() + A[1].checknumber();
+        return { C[0] };
+      }
+    };
+
+    struct add_t : proto_t {
+      add_t()
+        : proto_t(uparray_t {}) {}
+
+      array_t operator()(const array_t& args) {
+        add_program program(args);
+        return program.entry();
+      }
+    };
+  }
+}
+
+int main(int, char*[]) {
+  using namespace dromozoa::runtime;
+  using dromozoa::bench::bench;
+
+  static const std::size_t n = 1000000;
+
+  const value_t native = [](value_t a, value_t b) -> value_t {
+    return a.checknumber() + b.checknumber();
+  };
+  const value_t variadic = [](array_t args) -> value_t {
+    return static_cast<double>(args.size);
+  };
+  const value_t proto = make_ptr<add_t>();
+
+  bench("native call1(2)", n, [&](std::size_t i) {
+    return call1(native, { i, 1 }).number;
+  });
+  bench("native call0(2)", n, [&](std::size_t i) {
+    call0(native, { i, 1 });
+    return 0;
+  });
+  bench("native call(2)", n, [&](std::size_t i) {
+    return call(native, { i, 1 })[0].number;
+  });
+  bench("variadic call1(3)", n, [&](std::size_t i) {
+    return call1(variadic, { i, 1, 2 }).number;
+  });
+  bench("variadic call1(5)", n, [&](std::size_t i) {
+    return call1(variadic, { i, 1, 2, 3, 4 }).number;
+  });
+  bench("proto call1(2)", n, [&](std::size_t i) {
+    return call1(proto, { i, 1 }).number;
+  });
+
+  return 0;
+}
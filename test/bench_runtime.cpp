@@ -0,0 +1,224 @@
+// Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+//
+// This file is part of dromozoa-compiler.
+//
+// dromozoa-compiler is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dromozoa-compiler is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+//
+// You should have received a copy of the GNU General Public License
+// and a copy of the GCC Runtime Library Exception along with
+// dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "allocations.hpp"
+#include "runtime.hpp"
+
+#include <utility>
+
+int main(int, char*[]) {
+  using namespace dromozoa::runtime;
+  using dromozoa::bench::bench;
+
+  static const std::size_t n = 1000000;
+
+  const value_t string = "foobarbaz";
+  const value_t key = "key";
+  const value_t absent = "absent";
+  const value_t table = type_t::table;
+  for (std::int64_t i = 1; i <= 16; ++i) {
+    settable(table, i, i);
+  }
+  settable(table, key, 42);
+
+  // value_t
+
+  value_t slot;
+  bench("value_t copy (integer)", n, [&](std::size_t i) {
+    slot = value_t(static_cast<std::int64_t>(i));
+    return slot.integer;
+  });
+  bench("value_t copy (string)", n, [&](std::size_t) {
+    slot = string;
+    return slot.is_nil() ? 0 : 1;
+  });
+  bench("value_t copy (table)", n, [&](std::size_t) {
+    slot = table;
+    return slot.is_nil() ? 0 : 1;
+  });
+  bench("value_t move (table)", n, [&](std::size_t) {
+    value_t moved(std::move(slot));
+    slot = std::move(moved);
+    return slot.is_nil() ? 0 : 1;
+  });
+  bench("value_t destroy (table)", n, [&](std::size_t) {
+    { value_t copy(table); }
+    return 1;
+  });
+  slot = NIL;
+
+  // gettable and settable
+
+  const value_t index_table = type_t::table;
+  const value_t index_metatable = type_t::table;
+  settable(index_metatable, "__index", table);
+  setmetatable(index_table, index_metatable);
+
+  const value_t index_function = type_t::table;
+  const value_t function_metatable = type_t::table;
+  settable(function_metatable, "__index", [](value_t, value_t) -> value_t {
+    return 42;
+  });
+  settable(function_metatable, "__newindex", [](value_t, value_t, value_t) {});
+  setmetatable(index_function, function_metatable);
+
+  bench("gettable hit (array)", n, [&](std::size_t i) {
+    return gettable(table, static_cast<std::int64_t>(i % 16 + 1)).integer;
+  });
+  bench("gettable hit (hash)", n, [&](std::size_t) {
+    return gettable(table, key).integer;
+  });
+  bench("gettable miss", n, [&](std::size_t) {
+    return gettable(table, absent).is_nil() ? 0 : 1;
+  });
+  bench("gettable __index table", n, [&](std::size_t) {
+    return gettable(index_table, key).integer;
+  });
+  bench("gettable __index function", n, [&](std::size_t) {
+    return gettable(index_function, key).integer;
+  });
+  bench("settable hit (array)", n, [&](std::size_t i) {
+    settable(table, static_cast<std::int64_t>(i % 16 + 1), static_cast<std::int64_t>(i));
+    return 0;
+  });
+  bench("settable hit (hash)", n, [&](std::size_t i) {
+    settable(table, key, static_cast<std::int64_t>(i));
+    return 0;
+  });
+  bench("settable miss (insert and remove)", n, [&](std::size_t) {
+    settable(table, absent, 1);
+    settable(table, absent, NIL);
+    return 0;
+  });
+  bench("settable __newindex function", n, [&](std::size_t) {
+    settable(index_function, absent, 1);
+    return 0;
+  });
+
+  // call and call1
+
+  const value_t native0 = []() -> value_t {
+    return 1;
+  };
+  const value_t native1 = [](value_t a) -> value_t {
+    return a;
+  };
+  const value_t native2 = [](value_t a, value_t) -> value_t {
+    return a;
+  };
+  const value_t native3 = [](value_t a, value_t, value_t) -> value_t {
+    return a;
+  };
+  const value_t variadic = [](array_t args) -> array_t {
+    return args;
+  };
+
+  bench("call1(0)", n, [&](std::size_t) {
+    return call1(native0, {}).integer;
+  });
+  bench("call1(1)", n, [&](std::size_t) {
+    return call1(native1, { 1 }).integer;
+  });
+  bench("call1(2)", n, [&](std::size_t) {
+    return call1(native2, { 1, 2 }).integer;
+  });
+  bench("call1(3)", n, [&](std::size_t) {
+    return call1(native3, { 1, 2, 3 }).integer;
+  });
+  bench("call(1)", n, [&](std::size_t) {
+    return call(native1, { 1 })[0].integer;
+  });
+  bench("call(3) variadic", n, [&](std::size_t) {
+    return call(variadic, { 1, 2, 3 }).size;
+  });
+  bench("call(5) variadic", n, [&](std::size_t) {
+    return call(variadic, { 1, 2, 3, 4, 5 }).size;
+  });
+
+  // tostring and tonumber
+
+  const value_t integer_string = "12345";
+  const value_t float_string = "1.5";
+  const value_t long_float_string = "3.1415926535898";
+  const value_t exponent_string = "6.02214076e23";
+  const value_t hexadecimal_string = "0x7fffffff";
+
+  bench("tostring (integer)", n, [&](std::size_t i) {
+    return tostring(static_cast<std::int64_t>(i)).size();
+  });
+  bench("tostring (float)", n, [&](std::size_t i) {
+    return tostring(i + 0.5).size();
+  });
+  bench("tostring (float, 14 digits)", n, [&](std::size_t i) {
+    return tostring(i / 3.0).size();
+  });
+  bench("tostring (float, exponent)", n, [&](std::size_t i) {
+    return tostring(i * 1e20).size();
+  });
+  bench("tostring (string)", n, [&](std::size_t) {
+    return tostring(string).size();
+  });
+  bench("tonumber (integer string)", n, [&](std::size_t) {
+    return tonumber(integer_string).tofloat();
+  });
+  bench("tonumber (float string)", n, [&](std::size_t) {
+    return tonumber(float_string).tofloat();
+  });
+  bench("tonumber (long float string)", n, [&](std::size_t) {
+    return tonumber(long_float_string).tofloat();
+  });
+  bench("tonumber (exponent string)", n, [&](std::size_t) {
+    return tonumber(exponent_string).tofloat();
+  });
+  bench("tonumber (hexadecimal string)", n, [&](std::size_t) {
+    return tonumber(hexadecimal_string).tofloat();
+  });
+  bench("tonumber (number)", n, [&](std::size_t i) {
+    return tonumber(static_cast<std::int64_t>(i)).integer;
+  });
+
+  // len
+
+  bench("len (string)", n, [&](std::size_t) {
+    return len(string);
+  });
+  bench("len (table)", n, [&](std::size_t) {
+    return len(table);
+  });
+
+  // array_t::sub
+
+  const array_t small = { 1, 2, 3 };
+  const array_t large = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+  bench("array_t::sub (inline)", n, [&](std::size_t) {
+    return small.sub(1).size;
+  });
+  bench("array_t::sub (block)", n, [&](std::size_t) {
+    return large.sub(2).size;
+  });
+  bench("array_t::sub (block, range)", n, [&](std::size_t) {
+    return large.sub(2, 4).size;
+  });
+
+  return 0;
+}
@@ -0,0 +1,148 @@
+// Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+//
+// This file is part of dromozoa-compiler.
+//
+// dromozoa-compiler is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dromozoa-compiler is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// Under Section 7 of GPL version 3, you are granted additional
+// permissions described in the GCC Runtime Library Exception, version
+// 3.1, as published by the Free Software Foundation.
+//
+// You should have received a copy of the GNU General Public License
+// and a copy of the GCC Runtime Library Exception along with
+// dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "runtime.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dromozoa {
+  namespace runtime {
+    // the previous table implementation
+    struct map_table_t {
+      const value_t& get(const value_t& index) const {
+        const auto i = map.find(index);
+        if (i == map.end()) {
+          return NIL;
+        } else {
+          return i->second;
+        }
+      }
+
+      void set(const value_t& index, const value_t& value) {
+        if (value.is_nil()) {
+          map.erase(index);
+        } else {
+          map[index] = value;
+        }
+      }
+
+      std::int64_t len() const {
+        for (std::int64_t i = 1; ; ++i) {
+          if (get(i).is_nil()) {
+            return i - 1;
+          }
+        }
+      }
+
+      std::map<value_t, value_t> map;
+    };
+
+    template <class T>
+    double measure(T function, std::size_t n) {
+      const auto start = std::chrono::steady_clock::now();
+      function();
+      const auto stop = std::chrono::steady_clock::now();
+      return std::chrono::duration<double, std::nano>(stop - start).count() / n;
+    }
+
+    template <class T>
+    void bench(const char* name, std::size_t n, const std::vector<value_t>& keys) {
+      double sum = 0;
+      T table;
+      const auto set = measure([&]() {
+        for (const auto& key : keys) {
+          table.set(key, key);
+        }
+      }, n);
+      const auto get = measure([&]() {
+        for (const auto& key : keys) {
+          sum += table.get(key).is_nil() ? 0 : 1;
+        }
+      }, n);
+      const auto len = measure([&]() {
+        sum += table.len();
+      }, 1);
+      const auto erase = measure([&]() {
+        for (const auto& key : keys) {
+          table.set(key, NIL);
+        }
+      }, n);
+      std::cout
+          << name
+          << "\tset " << set << " ns/op"
+          << "\tget " << get << " ns/op"
+          << "\tlen " << len << " ns"
+          << "\terase " << erase << " ns/op"
+          << "\t(" << sum << ")\n";
+    }
+
+    template <class T>
+    void bench_setlist(const char* name, std::size_t n) {
+      const auto setlist = measure([&]() {
+        for (std::size_t i = 0; i < n / 16; ++i) {
+          T table;
+          for (std::size_t j = 1; j <= 16; ++j) {
+            table.set(j, j);
+          }
+        }
+      }, n);
+      std::cout << name << "\tsetlist(16) " << setlist << " ns/op\n";
+    }
+  }
+}
+
+int main(int, char*[]) {
+  using namespace dromozoa::runtime;
+
+  static const std::size_t n = 100000;
+
+  std::vector<value_t> sequence;
+  std::vector<value_t> reverse;
+  std::vector<value_t> string;
+  for (std::size_t i = 1; i <= n; ++i) {
+    sequence.push_back(i);
+    reverse.push_back(n - i + 1);
+    string.push_back("key" + std::to_string(i));
+  }
+
+  std::cout << "sequence\n";
+  bench<map_table_t>("map", n, sequence);
+  bench<table_t>("table", n, sequence);
+
+  std::cout << "reverse\n";
+  bench<map_table_t>("map", n, reverse);
+  bench<table_t>("table", n, reverse);
+
+  std::cout << "string\n";
+  bench<map_table_t>("map", n, string);
+  bench<table_t>("table", n, string);
+
+  std::cout << "setlist\n";
+  bench_setlist<map_table_t>("map", n);
+  bench_setlist<table_t>("table", n);
+
+  return 0;
+}
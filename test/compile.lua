@@ -51,10 +51,27 @@ local opts = {
   mode = os.getenv "MODE"
 }
 
-t:generate()
+-- OPTIMIZE is "all" or a comma separated list of the passes.
+local optimize = os.getenv "OPTIMIZE"
+if optimize == "all" then
+  opts.optimize = true
+elseif optimize then
+  opts.optimize = {}
+  for name in optimize:gmatch "[^,]+" do
+    opts.optimize[name] = true
+  end
+end
+
+t:generate(opts)
 
 t:compile_es(output_name .. ".js", opts)
 t:compile_cxx(output_name .. ".cpp", opts)
+
+-- NO_DUMP skips the dumps, for bench/bench.sh.
+if os.getenv "NO_DUMP" then
+  return
+end
+
 t:dump_tree(output_name .. ".html")
 t:dump_protos(output_name .. ".txt", opts)
 for i = 1, #t.protos do
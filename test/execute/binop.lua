@@ -48,3 +48,7 @@ local p3 = function () return 2 end
 
 print(p1 == p1, p1 == p2, p1 == p3)
 print(p1 ~= p1, p1 ~= p2, p1 ~= p3)
+
+print("10" + 1 == 11, 10 - "4" == 6, "6" * "7" == 42, "42" / 8 == 5.25, "42" // "8" == 5, 2 ^ "3" == 8)
+print("abc" < "abd", "abc" < "abc", "abc" <= "abc", "abd" <= "abc")
+print(0 == -0, 1 / 0 == 1 / 0, 0 / 0 == 0 / 0, 0 / 0 ~= 0 / 0)
@@ -0,0 +1,54 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local function make(i)
+  local t = { i }
+  t.self = t
+  local u = { t = t }
+  t.u = u
+  local function f()
+    return f, t
+  end
+  t.f = f
+  return setmetatable({}, { __index = t })
+end
+
+local keep = make(0)
+for i = 1, 1000 do
+  make(i)
+end
+
+print(collectgarbage())
+print(type(collectgarbage "count"))
+print(type(collectgarbage "step"))
+print(collectgarbage "isrunning")
+
+print(keep[1], keep.self[1], keep.u.t[1])
+local f, t = keep.f()
+print(f == keep.f, t == keep.self)
+
+print(collectgarbage("setpause", 100))
+print(collectgarbage("setpause", 200))
+print(collectgarbage("setstepmul", 400))
+print(collectgarbage("setstepmul", 200))
+
+print(collectgarbage "stop")
+print(collectgarbage "isrunning")
+print(collectgarbage "restart")
+print(collectgarbage "isrunning")
+
+print(pcall(collectgarbage, "foo"))
@@ -0,0 +1,43 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local a = "a"
+local b = "b"
+local n = 42
+local x = 0.5
+print(a .. b)
+print(a .. b .. a .. b)
+print(a .. n .. b .. x .. n)
+print((a .. b) .. (b .. a) .. a)
+print(n .. n)
+print(-1 .. "" .. -0.25)
+print(1 .. 2 .. 3 .. 4 .. 5 .. 6 .. 7 .. 8 .. 9 .. 10 .. 11 .. 12)
+print(x .. x .. x .. x .. x .. x .. x .. x .. x .. x)
+
+local s = ""
+for i = 1, 10 do
+  s = s .. i .. ","
+end
+print(s)
+
+local function f()
+  return "f"
+end
+print(a .. f() .. b .. f())
+print((pcall(function () return a .. nil .. b end)))
+print((pcall(function () return a .. {} end)))
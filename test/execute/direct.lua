@@ -0,0 +1,73 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local function fib(n)
+  if n < 2 then
+    return n
+  end
+  return fib(n - 1) + fib(n - 2)
+end
+print(fib(20))
+
+local function pair(a, b)
+  return b, a
+end
+print(pair(1))
+print(pair(1, 2, 3))
+print((pair(1, 2)))
+
+local function counter(n)
+  local function inc()
+    n = n + 1
+    return n
+  end
+  inc()
+  return inc(), n
+end
+print(counter(10))
+
+local function outer(n)
+  local function inner(m)
+    if m == 0 then
+      return n
+    end
+    return inner(m - 1) + 1
+  end
+  return inner(n)
+end
+print(outer(5))
+
+local function sum(...)
+  local n = 0
+  local t = { ... }
+  for i = 1, #t do
+    n = n + t[i]
+  end
+  return n
+end
+print(sum(1, 2, 3))
+print(pair(pair(1, 2)))
+
+local function f()
+  return "f"
+end
+print(f())
+f = function ()
+  return "g"
+end
+print(f())
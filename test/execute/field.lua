@@ -0,0 +1,85 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local function get(t)
+  return t.x, t.y, t.z
+end
+
+local function set(t, x, y, z)
+  t.x = x
+  t.y = y
+  t.z = z
+end
+
+-- the same sites on the tables of different layouts.
+local a = { x = 1, y = 2, z = 3 }
+local b = { z = 4, w = 5, y = 6, v = 7 }
+local c = {}
+print(get(a))
+print(get(b))
+print(get(c))
+print(get(a))
+
+-- the slots move on the removals and the rehashes.
+for i = 1, 3 do
+  set(c, i, i + 1, i + 2)
+  print(get(c))
+  c.y = nil
+  print(get(c))
+  for j = 1, 10 do
+    c["k" .. j] = j
+  end
+  print(get(c))
+  c.x = nil
+  c.z = nil
+  print(get(c))
+end
+
+-- __index and __newindex.
+local base = { x = "base.x" }
+local derived = setmetatable({ y = "derived.y" }, { __index = base })
+local object = setmetatable({ z = "object.z" }, { __index = derived })
+print(get(object))
+base.x = "base.x2"
+print(get(object))
+object.x = "object.x"
+print(get(object))
+object.x = nil
+print(get(object))
+
+local mt = {}
+local proxy = setmetatable({}, mt)
+print(get(proxy))
+mt.__index = function (_, k)
+  return "index." .. k
+end
+print(get(proxy))
+local log = {}
+mt.__newindex = function (_, k, v)
+  log[#log + 1] = k .. "=" .. tostring(v)
+end
+set(proxy, 1, 2, 3)
+print(log[1], log[2], log[3], #log)
+print(get(proxy))
+mt.__newindex = nil
+set(proxy, 4, 5, 6)
+print(get(proxy))
+
+-- the strings look up their methods.
+local s = "foobar"
+print(s:sub(2, 4), s:len())
@@ -42,3 +42,46 @@ for i = 1, 4 do
     end
   end
 end
+
+local n = 5
+local s = 0
+for i = 1, n do
+  s = s + i
+end
+print(s)
+
+for i = 1, 3.5 do
+  print(i)
+end
+
+for i = 3, 1.5, -1 do
+  print(i)
+end
+
+for i = 0.5, 2 do
+  print(i)
+end
+
+for i = 1, 2, 0.25 do
+  print(i + 0.125)
+end
+
+for i = 2, 1 do
+  print(i)
+end
+
+local step = -3
+for i = 10, 1, step do
+  print(i)
+end
+
+for i = 1, 1e300 do
+  if i > 3 then
+    break
+  end
+  print(i)
+end
+
+for i = "2", 4 do
+  print(i == 2 or i == 3 or i == 4)
+end
@@ -0,0 +1,63 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local a = 7
+local b = 2
+local c = -3
+print(a // b, -a // b, a // c, a % b)
+print(a == 7.0, a < 7.5, 7.5 < a, b <= 2.0)
+print(5.5 % 2, 7.5 // 2 == 3)
+print(a & 3, a | 8, a ~ 5, ~a)
+print(1 << 4, 256 >> 4, a << 2 >> 1)
+print(a / b, 2 ^ 10 == 1024)
+print(tostring(10), tostring(-10), 10 .. "")
+
+local t = {}
+t[1] = "a"
+t[2.0] = "b"
+t[3] = "c"
+print(#t, t[1.0], t[2], t[3.0])
+
+local s = 0
+for i = 1, 100 do
+  s = s + i * i % 7
+end
+print(s)
+
+local x = 0
+local y = 1
+for i = 1, 30 do
+  x, y = y, x + y
+end
+print(x, y)
+
+print("10" + 1 == 11, "0x10" + 0 == 16, "3" * "4" == 12)
+
+-- the integers beyond 2^53 are not exact as floats. the ES runtime has no
+-- integers, so only the cases within 2^53 are checked there.
+local v = { 9007199254740993, 9007199254740992.0, 9223372036854775807, 2^63, -9223372036854775807 - 1, -2^63, 0 / 0, 1 / 0 }
+local exact = v[1] ~= v[2]
+local function check(v)
+  return v or not exact
+end
+print(check(v[1] > v[2]), check(not (v[1] <= v[2])), check(v[2] < v[1]), check(not (v[2] >= v[1])))
+print(check(v[3] < v[4]), check(v[3] <= v[4]), check(v[4] > v[3]), check(not (v[4] <= v[3])))
+print(check(not (v[5] < v[6])), v[5] <= v[6], check(not (v[6] < v[5])), v[6] <= v[5])
+print(v[1] < v[7], v[1] <= v[7], v[7] < v[1], v[7] <= v[1], v[7] < 1, 1 <= v[7])
+print(v[3] < v[8], v[5] > -v[8], v[8] <= v[3], -v[8] >= v[5])
+print(check(v[1] < 9007199254740994.0), check(not (v[1] > 9007199254740994.0)), 5 < 5.5, 5 <= 4.5, 5.5 <= 5, -5.5 < -5)
+print(check(not (1152921504606846976 < 0.5)), check(-1152921504606846976 < 0.5), check(not (0.5 <= -1152921504606846976)))
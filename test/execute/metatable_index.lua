@@ -60,3 +60,13 @@ t1.baz = 6
 
 print(t1.foo, t1.bar, t1.baz)
 print(t2.foo, t2.bar, t2.baz)
+
+local metatable = {}
+local t3 = setmetatable({}, metatable)
+print(t3.foo, t3.foo)
+metatable.__index = class
+print(t3.foo, t3.foo)
+metatable.__index = nil
+print(t3.foo, t3.foo)
+metatable.__index = function (_, k) return k .. k end
+print(t3.foo, t3.foo)
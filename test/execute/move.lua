@@ -0,0 +1,59 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local function pair(a, b)
+  return a, b
+end
+
+local function count(t)
+  local n = 0
+  for _ in ipairs(t) do
+    n = n + 1
+  end
+  return n
+end
+
+local t = { 1, 2, 3 }
+local a, b = pair(t, t)
+print(a == t, b == t, #a, #b)
+
+local s = "foo"
+local u = s
+print(pair(s, u))
+print(s, u)
+
+local x = {}
+for i = 1, 4 do
+  local y = x
+  y[i] = "v" .. i
+  x = y
+end
+print(count(x), x[1], x[4])
+
+local function last(v)
+  local w = v
+  return w
+end
+local z = last(t)
+print(z == t, #t)
+
+local function chain(v)
+  return pair(last(v), v)
+end
+local p, q = chain("bar")
+print(p, q)
@@ -0,0 +1,63 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local x = 2 * 3 + 1
+local y = x
+local z = y + 1
+print(x, y, z, x // 2, x % 4, x & 3, 1 << 4, ~0)
+print(1 < 2, 2 <= 1, 1 == 1.0, "a" == "a", "a" ~= "b", not nil)
+print(1 / 2, 7 // 0.5 == 14, -(-3))
+
+if 1 < 2 then
+  print "then"
+else
+  print "else"
+end
+
+if nil then
+  print "nil"
+end
+
+while false do
+  print "while"
+end
+
+repeat
+  local t = {}
+until true
+
+local a = 1
+local b = a
+a = 2
+print(a, b)
+
+local function f(n)
+  local m = n
+  local unused = m * 2
+  if m then
+    return m
+  end
+  return "never"
+end
+print(f(42))
+
+local s = 0
+local k = 3
+for i = 1, 10, k do
+  s = s + i
+end
+print(s)
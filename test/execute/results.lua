@@ -0,0 +1,45 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local function f(...)
+  local a, b = select(1, ...)
+  return a, b
+end
+print(f("a", "b", "c"))
+
+-- assert returns its arguments, which share the varargs.
+local function g(...)
+  local x = { "x", assert(...) }
+  print(#x, x[1], x[2], x[3])
+  return "y", assert(...)
+end
+print(g("a", "b"))
+
+local function h(...)
+  local x = assert(...)
+  return x, ...
+end
+print(h("a", "b"))
+
+local function forward(...)
+  return ...
+end
+print(forward(forward("a", "b", "c", "d")))
+print((forward("a", "b")))
+print(forward())
+print(pcall(forward, "a", "b"))
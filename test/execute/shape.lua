@@ -0,0 +1,83 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local function point(x, y)
+  return { x = x, y = y }
+end
+
+-- the tables of a same shape, and of the keys in the other order.
+local p = point(1, 2)
+local q = point(3, 4)
+local r = { y = 5, x = 6 }
+print(p.x, p.y, q.x, q.y, r.x, r.y)
+
+-- the removed keys are absent, and can be added again.
+p.x = nil
+print(p.x, p.y, rawget(p, "x"))
+p.x = 7
+p.z = 8
+print(p.x, p.y, p.z, q.z)
+
+-- the table becomes dynamic with too many keys.
+local t = {}
+local keys = {}
+for i = 1, 40 do
+  keys[i] = "key" .. i
+  t[keys[i]] = i
+end
+local sum = 0
+for i = 1, 40 do
+  sum = sum + t[keys[i]]
+end
+print(sum, t.key1, t.key16, t.key17, t.key40)
+for i = 1, 40, 2 do
+  t[keys[i]] = nil
+end
+print(t.key1, t.key2, t.key39, t.key40)
+
+-- the keys of the other types and the long strings are mixed.
+local long = "0123456789abcdefghijklmnopqrstuvwxyz" .. "0123456789abcdefghijklmnopqrstuvwxyz"
+local u = { 1, 2, name = "u", [true] = "yes", [long] = "long" }
+u.size = #u
+u[3] = 3
+print(u[1], u[2], u[3], u.name, u[true], u[long], u.size, #u)
+
+-- the metatables are shaped tables as well.
+local mt = { kind = "mt" }
+local v = setmetatable({}, mt)
+print(v.kind, v.missing)
+mt.__index = mt
+print(v.kind, v.missing)
+mt.__index = nil
+print(v.kind)
+mt.__index = function (_, k)
+  return k .. "!"
+end
+print(v.kind, v.x)
+
+-- many objects of the same shape.
+local objects = {}
+for i = 1, 100 do
+  objects[i] = { id = i, name = "o" .. i, value = i * i }
+end
+local total = 0
+for i = 1, 100 do
+  local o = objects[i]
+  total = total + o.id + o.value + #o.name
+end
+print(total)
@@ -0,0 +1,63 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local s = ""
+for i = 1, 100 do
+  s = s .. i .. ":"
+end
+print(#s)
+
+-- the long substrings share the buffer of s.
+local a = s:sub(11, 400)
+local b = s:sub(11, 400)
+print(#a, a == b, a:sub(1, 10), a:sub(-10))
+
+local t = {}
+t[a] = "a"
+print(t[b], t[s:sub(11, 400)])
+
+-- the equal substrings are the same key of a record.
+local u = {}
+u[a] = 1
+u[b] = 2
+u[s:sub(11, 400)] = 3
+print(u[a], u[b])
+u[b] = nil
+print(u[a], u[s:sub(11, 400)])
+
+local c = a:sub(101, 380)
+print(#c, c == s:sub(111, 390), c:byte(1), c:byte(-1))
+print(a < s, s < a, a <= b, c:sub(1, 1) == s:sub(111, 111))
+print(string.len(c), string.sub(c, 5, 8))
+
+local n = 0
+for i = 1, #s do
+  if s:byte(i) == 58 then
+    n = n + 1
+  end
+end
+print(n)
+
+local rest = s
+local count = 0
+while #rest > 0 do
+  rest = rest:sub(2)
+  count = count + 1
+end
+print(count)
+print(("x"):sub(1), string.sub(12345, 2, 3), string.len(12345))
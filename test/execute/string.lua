@@ -57,3 +57,13 @@ for i = -4, 4 do
 end
 
 print(getmetatable("foo").__index == string)
+
+local short = "foo" .. "bar"
+local long = "0123456789abcdefghijklmnopqrstuvwxyz" .. "0123456789abcdefghijklmnopqrstuvwxyz"
+local t = {
+  foobar = 1;
+  ["0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz"] = 2;
+}
+print(short == "foobar", short ~= "foobaz", t[short])
+print(long == "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz", t[long])
+print(long .. "" == long, long < long .. "0", long <= long)
@@ -0,0 +1,133 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+
+local function is_border(t, n)
+  return (n == 0 or t[n] ~= nil) and t[n + 1] == nil
+end
+
+local t = {}
+for i = 1, 40 do
+  t[i] = i
+end
+t[20] = nil
+print(is_border(t, #t))
+t[40] = nil
+print(is_border(t, #t))
+for i = 1, 40, 3 do
+  t[i] = nil
+end
+print(is_border(t, #t))
+print(is_border({ 1, 2, nil, 4 }, #{ 1, 2, nil, 4 }))
+print(is_border({ nil, nil, 3 }, #{ nil, nil, 3 }))
+
+-- the keys stay in the hash part until the array part would be half used
+local t = {}
+for i = 100, 1, -1 do
+  t[i] = i * 2
+end
+print(#t, t[1], t[50], t[100], t[101])
+local sum = 0
+for i = 1, #t do
+  sum = sum + t[i]
+end
+print(sum)
+
+local t = {}
+for i = 2, 32 do
+  t[i] = i
+end
+print(t[1], t[2], t[32])
+t[1] = 1
+print(#t)
+for i = 32, 17, -1 do
+  t[i] = nil
+end
+print(#t, t[16], t[17])
+for i = 1, 16 do
+  t[i] = nil
+end
+print(#t, t[1], t[16])
+for i = 1, 10 do
+  t[i] = -i
+end
+print(#t, t[1], t[10], t[11])
+for i = 50, 80 do
+  t[i] = i
+end
+print(t[10], t[11], t[50], t[80])
+
+-- floats with integer values are the same keys as the integers
+local t = {}
+t[1.0] = "a"
+print(t[1])
+t[2] = "b"
+print(t[2.0], #t)
+t[2^53] = "c"
+print(t[2^53], t[9007199254740992])
+t[1.5] = "d"
+print(t[1.5], #t)
+t[1.0] = nil
+print(t[1], t[2])
+
+local t = {}
+for i = 1, 40 do
+  t[i * 7.5] = i
+end
+for i = 1, 40, 2 do
+  t[i * 7.5] = nil
+end
+local count = 0
+for i = 1, 40 do
+  if t[i * 7.5] ~= nil then
+    count = count + 1
+  end
+end
+print(count)
+for i = 1, 40, 2 do
+  t[i * 7.5] = -i
+end
+local ok = true
+for i = 1, 40, 2 do
+  if t[i * 7.5] ~= -i or t[(i + 1) * 7.5] ~= i + 1 then
+    ok = false
+  end
+end
+print(ok)
+
+local t = {}
+for i = 1, 30 do
+  t["key" .. i] = i
+end
+for i = 1, 30 do
+  if i % 3 ~= 0 then
+    t["key" .. i] = nil
+  end
+end
+local sum = 0
+for i = 1, 30 do
+  sum = sum + (t["key" .. i] or 0)
+end
+print(sum)
+for i = 1, 30 do
+  t["key" .. i] = i
+end
+local sum = 0
+for i = 1, 30 do
+  sum = sum + t["key" .. i]
+end
+print(sum)
@@ -22,3 +22,25 @@ print(tonumber "34e1" == 340)
 print(tonumber "foo")
 print(tonumber " foo 42 ")
 print(tonumber " 42 foo ")
+
+print(tonumber " 0x10 ")
+print(tonumber "-0X1f")
+print(tonumber "0x1p4" == 16)
+print(tonumber "0x.8" == 0.5)
+print(tonumber "0x" == nil)
+print(tonumber "0x1p" == nil)
+print(tonumber "+12")
+print(tonumber "- 12")
+print(tonumber "1." == 1)
+print(tonumber ".5")
+print(tonumber ".")
+print(tonumber "1e")
+print(tonumber "1E+2" == 100)
+print(tonumber "2.5e-1")
+print(tonumber "1.2.3")
+print(tonumber "inf")
+print(tonumber "nan")
+print(tonumber "1e400" == 1 / 0)
+print(tonumber "3.14159265358979323846" == 3.14159265358979323846)
+print(tonumber "123456789012345678901234567890" == 123456789012345678901234567890)
+print(tonumber "9007199254740993" == 9007199254740992 + 1)
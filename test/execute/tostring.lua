@@ -27,3 +27,10 @@ print(tostring(nil))
 print(tostring(false))
 print(tostring(true))
 print(tostring(t))
+
+print(0.5, -0.25, 0.125, 1e-3, 1234.5678, -98765.4321)
+local values = { 0.1, 0.3, 1e-5, 123456789.125, 6.02214076e23, 1e100 }
+for i = 1, #values do
+  local v = values[i]
+  print(tonumber(tostring(v)) == v, tonumber(tostring(-v)) == -v, #tostring(v) <= 20)
+end
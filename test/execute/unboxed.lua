@@ -0,0 +1,88 @@
+-- Copyright (C) 2018 Tomoyuki Fujimori <moyu@dromozoa.com>
+--
+-- This file is part of dromozoa-compiler.
+--
+-- dromozoa-compiler is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- dromozoa-compiler is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with dromozoa-compiler.  If not, see <http://www.gnu.org/licenses/>.
+
+local print = print
+
+local function sum(n)
+  local s = 0
+  for i = 1, n do
+    s = s + i
+  end
+  return s
+end
+print(sum(100) == 5050)
+
+-- the type of x changes at the merge
+local function f(c)
+  local x = 1
+  if c then
+    x = "one"
+  end
+  return x
+end
+print(f(false) == 1, f(true))
+
+-- a flag and a number in a loop
+local function g(n)
+  local even = true
+  local k = 0
+  while k < n do
+    even = not even
+    k = k + 1
+  end
+  return even, k
+end
+print(g(3))
+print(g(4))
+
+-- the local is modified by a closure
+local function h()
+  local x = 1
+  local function inc()
+    x = x + 1
+  end
+  inc()
+  inc()
+  return x == 3
+end
+print(h())
+
+-- comparisons of mixed types
+local function cmp(a)
+  local x = 2
+  local b = true
+  return x == a, b == a, x ~= b
+end
+print(cmp(2))
+print(cmp(true))
+print(cmp("2"))
+
+-- the local is read before it is assigned in the loop
+local function u(n)
+  local r = {}
+  for i = 1, n do
+    local y
+    r[i] = y == nil
+    y = i
+  end
+  return r[1], r[2]
+end
+print(u(2))
+
+local a = 0.5
+local b = 1 / 3
+print(a * 4 == 2, b * 3 == 1, 7 // 2 == 3, 7 % 3 == 1, 2 ^ 10 == 1024, -a == -0.5)
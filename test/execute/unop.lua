@@ -31,3 +31,4 @@ print(#{1,2})
 print(#{1,2,3})
 print(#{1,2,3,4})
 print(~0xDEAD)
+print(-"42" == -42, -"-17" == 17)
@@ -22,6 +22,7 @@
 
 #include "runtime.hpp"
 
+#include <chrono>
 #include <iostream>
 
 namespace dromozoa {
@@ -65,12 +66,93 @@ namespace dromozoa {
     };
 
     struct not_callable_t {};
+
+    template <class T>
+    double measure(T function) {
+      const auto start = std::chrono::steady_clock::now();
+      function();
+      const auto stop = std::chrono::steady_clock::now();
+      return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+
+    void footprint(const char* name, std::size_t bytes, std::size_t n) {
+      std::cout
+          << name << "\t"
+          << bytes << " bytes\t"
+          << static_cast<double>(bytes) / n << " bytes/element\n";
+    }
+
+    // a copy of the array in a block of its own, since sub shares the block.
+    array_t copy_array(const array_t& array) {
+      array_t copy(array.size);
+      for (std::size_t i = 0; i < array.size; ++i) {
+        copy[i] = array[i];
+      }
+      return copy;
+    }
+
+    void bench_footprint(std::size_t n) {
+      std::cout
+          << "sizeof(value_t) " << sizeof(value_t) << "\n"
+          << "sizeof(node_t) " << sizeof(node_t) << "\n";
+
+      {
+        array_t array(n);
+        const auto fill = measure([&]() {
+          for (std::size_t i = 0; i < n; ++i) {
+            array[i] = i;
+          }
+        });
+        array_t copy;
+        const auto copy_number = measure([&]() {
+          copy = copy_array(array);
+        });
+        copy = array_t();
+        for (std::size_t i = 0; i < n; ++i) {
+          array[i] = type_t::table;
+        }
+        const auto copy_table = measure([&]() {
+          copy = copy_array(array);
+        });
+        const auto destruct_table = measure([&]() {
+          copy = array_t();
+        });
+        footprint("array_t", sizeof(value_t) * array.size, n);
+        std::cout
+            << "  fill number " << fill / n << " ns/op\n"
+            << "  copy number " << copy_number / n << " ns/op\n"
+            << "  copy table " << copy_table / n << " ns/op\n"
+            << "  destruct table " << destruct_table / n << " ns/op\n";
+      }
+
+      {
+        table_t table;
+        const auto fill = measure([&]() {
+          for (std::size_t i = 1; i <= n; ++i) {
+            table.set(i, i);
+          }
+        });
+        footprint("table_t array", sizeof(value_t) * table.array.capacity() + sizeof(node_t) * table.node.size(), n);
+        std::cout << "  fill " << fill / n << " ns/op\n";
+      }
+
+      {
+        table_t table;
+        const auto fill = measure([&]() {
+          for (std::size_t i = 1; i <= n; ++i) {
+            table.set(i + 0.5, i);
+          }
+        });
+        footprint("table_t node", sizeof(value_t) * table.array.capacity() + sizeof(node_t) * table.node.size(), n);
+        std::cout << "  fill " << fill / n << " ns/op\n";
+      }
+    }
   }
 }
 
 int main(int, char*[]) {
   using namespace dromozoa::runtime;
-  std::cout << sizeof(value_t) << "\n";
+  bench_footprint(1000000);
 
   std::string s = "bar";
 
@@ -233,7 +315,7 @@ int main(int, char*[]) {
   }
 
   {
-    array_t A { "foo", 42, true };
+    registers_t A { "foo", 42, true };
     uparray_t S {
       { A, 0 },
     };